@@ -0,0 +1,97 @@
+#include "adaptive_execution.h"
+
+ExecutionMode ExecutionCostModel::Choose(ExecutionOperation operation, uint64_t work) const {
+    if (thread_count <= 1) {
+        return ExecutionMode::SEQUENTIAL;
+    }
+    uint64_t min_work = 0;
+    switch (operation) {
+    case ExecutionOperation::MATCH_DOCUMENT:
+        min_work = match_parallel_min_work;
+        break;
+    case ExecutionOperation::REMOVE_DOCUMENT:
+        min_work = remove_parallel_min_work;
+        break;
+    default:
+        min_work = find_parallel_min_work;
+    }
+    return work >= min_work ? ExecutionMode::PARALLEL : ExecutionMode::SEQUENTIAL;
+}
+
+ExecutionMode ExecutionCostModel::ChooseBatch(size_t query_count) const {
+    if (thread_count <= 1 || query_count < 2) {
+        return ExecutionMode::SEQUENTIAL;
+    }
+    return query_count >= thread_count * batch_min_queries_per_thread ? ExecutionMode::BATCHED : ExecutionMode::SEQUENTIAL;
+}
+
+const ExecutionDecisionStats& ExecutionStats::Get(ExecutionOperation operation, ExecutionMode mode) const {
+    return decisions[static_cast<int>(operation)][static_cast<int>(mode)];
+}
+
+std::ostream& operator<<(std::ostream& out, const ExecutionStats& stats) {
+    static const char* OPERATION_NAMES[EXECUTION_OPERATION_COUNT] = { "FindTopDocuments", "MatchDocument", "RemoveDocument", "ProcessQueries" };
+    static const char* MODE_NAMES[EXECUTION_MODE_COUNT] = { "seq", "par", "batch" };
+    bool first = true;
+    for (int operation = 0; operation < EXECUTION_OPERATION_COUNT; ++operation) {
+        for (int mode = 0; mode < EXECUTION_MODE_COUNT; ++mode) {
+            const ExecutionDecisionStats& decision = stats.decisions[operation][mode];
+            if (decision.count == 0) {
+                continue;
+            }
+            if (!first) {
+                out << std::endl;
+            }
+            first = false;
+            out << OPERATION_NAMES[operation] << " " << MODE_NAMES[mode] << ": count = " << decision.count
+                << ", work = " << decision.total_work << ", time = " << decision.total_time_us << " us";
+        }
+    }
+    return out;
+}
+
+ExecutionStatsRecorder::ExecutionStatsRecorder(const ExecutionStatsRecorder& other) {
+    Assign(other.GetStats());
+}
+
+ExecutionStatsRecorder& ExecutionStatsRecorder::operator=(const ExecutionStatsRecorder& other) {
+    if (this != &other) {
+        Assign(other.GetStats());
+    }
+    return *this;
+}
+
+void ExecutionStatsRecorder::Record(ExecutionOperation operation, ExecutionMode mode, uint64_t work, uint64_t time_us) {
+    Counter& counter = counters_[static_cast<int>(operation)][static_cast<int>(mode)];
+    counter.count.fetch_add(1, std::memory_order_relaxed);
+    counter.total_work.fetch_add(work, std::memory_order_relaxed);
+    counter.total_time_us.fetch_add(time_us, std::memory_order_relaxed);
+}
+
+ExecutionStats ExecutionStatsRecorder::GetStats() const {
+    ExecutionStats stats;
+    for (int operation = 0; operation < EXECUTION_OPERATION_COUNT; ++operation) {
+        for (int mode = 0; mode < EXECUTION_MODE_COUNT; ++mode) {
+            const Counter& counter = counters_[operation][mode];
+            stats.decisions[operation][mode] = { counter.count.load(std::memory_order_relaxed),
+                counter.total_work.load(std::memory_order_relaxed), counter.total_time_us.load(std::memory_order_relaxed) };
+        }
+    }
+    return stats;
+}
+
+void ExecutionStatsRecorder::Reset() {
+    Assign({});
+}
+
+void ExecutionStatsRecorder::Assign(const ExecutionStats& stats) {
+    for (int operation = 0; operation < EXECUTION_OPERATION_COUNT; ++operation) {
+        for (int mode = 0; mode < EXECUTION_MODE_COUNT; ++mode) {
+            const ExecutionDecisionStats& decision = stats.decisions[operation][mode];
+            Counter& counter = counters_[operation][mode];
+            counter.count.store(decision.count, std::memory_order_relaxed);
+            counter.total_work.store(decision.total_work, std::memory_order_relaxed);
+            counter.total_time_us.store(decision.total_time_us, std::memory_order_relaxed);
+        }
+    }
+}
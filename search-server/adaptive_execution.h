@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+// политика выполнения, при которой сервер сам выбирает последовательное или параллельное
+// выполнение по оценке работы: SearchServer::FindTopDocuments(adaptive_policy, query)
+struct AdaptivePolicy {};
+inline constexpr AdaptivePolicy adaptive_policy{};
+
+enum class ExecutionMode {
+    SEQUENTIAL,
+    // параллельно внутри одного запроса
+    PARALLEL,
+    // пакет запросов параллельно между запросами, каждый запрос последовательно
+    BATCHED,
+};
+const int EXECUTION_MODE_COUNT = 3;
+
+enum class ExecutionOperation {
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+    REMOVE_DOCUMENT,
+    PROCESS_QUERIES,
+};
+const int EXECUTION_OPERATION_COUNT = 4;
+
+// модель стоимости. Работа поиска - сумма документных частот слов запроса, работа
+// MatchDocument - количество слов запроса, работа RemoveDocument - количество слов документа.
+// Операция выполняется параллельно, если ее работа не меньше порога
+struct ExecutionCostModel {
+    uint64_t find_parallel_min_work = 20000;
+    uint64_t match_parallel_min_work = 256;
+    uint64_t remove_parallel_min_work = 512;
+    // пакет выполняется параллельно между запросами, если запросов не меньше, чем потоков
+    size_t batch_min_queries_per_thread = 1;
+    // при одном потоке все выполняется последовательно
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    ExecutionMode Choose(ExecutionOperation operation, uint64_t work) const;
+    ExecutionMode ChooseBatch(size_t query_count) const;
+};
+
+// статистика решений одного вида: сколько раз выбрано, суммарная оценка работы и время
+struct ExecutionDecisionStats {
+    uint64_t count = 0;
+    uint64_t total_work = 0;
+    uint64_t total_time_us = 0;
+};
+
+struct ExecutionStats {
+    std::array<std::array<ExecutionDecisionStats, EXECUTION_MODE_COUNT>, EXECUTION_OPERATION_COUNT> decisions;
+
+    const ExecutionDecisionStats& Get(ExecutionOperation operation, ExecutionMode mode) const;
+};
+
+std::ostream& operator<<(std::ostream& out, const ExecutionStats& stats);
+
+// потокобезопасные счетчики решений. Копирование переносит текущие значения, чтобы
+// содержащий их SearchServer оставался копируемым
+class ExecutionStatsRecorder {
+public:
+    ExecutionStatsRecorder() = default;
+    ExecutionStatsRecorder(const ExecutionStatsRecorder& other);
+    ExecutionStatsRecorder& operator=(const ExecutionStatsRecorder& other);
+
+    void Record(ExecutionOperation operation, ExecutionMode mode, uint64_t work, uint64_t time_us);
+    ExecutionStats GetStats() const;
+    void Reset();
+
+private:
+    struct Counter {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> total_work = 0;
+        std::atomic<uint64_t> total_time_us = 0;
+    };
+
+    std::array<std::array<Counter, EXECUTION_MODE_COUNT>, EXECUTION_OPERATION_COUNT> counters_;
+
+    void Assign(const ExecutionStats& stats);
+};
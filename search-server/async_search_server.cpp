@@ -0,0 +1,95 @@
+#include "async_search_server.h"
+
+std::optional<QueryStreamItem> QueryStream::Next() {
+    std::unique_lock lock(state_->mutex);
+    state_->ready.wait(lock, [&] { return !state_->items.empty() || state_->remaining == 0; });
+    if (state_->items.empty()) {
+        return std::nullopt;
+    }
+    QueryStreamItem item = std::move(state_->items.front());
+    state_->items.pop_front();
+    return item;
+}
+
+size_t QueryStream::GetQueryCount() const {
+    return query_count_;
+}
+
+void QueryStream::Cancel() {
+    cancellation_.Cancel();
+}
+
+QueryStream::QueryStream(std::shared_ptr<State> state, size_t query_count, CancellationSource cancellation)
+    : state_(std::move(state)), query_count_(query_count), cancellation_(std::move(cancellation)) {
+}
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, size_t thread_count)
+    : search_server_(search_server), pool_(thread_count) {
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::FindTopDocuments(std::string raw_query, const CancellationToken& cancellation) {
+    return FindTopDocuments(std::move(raw_query), DocumentFilter{}, cancellation);
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::FindTopDocuments(std::string raw_query, const DocumentFilter& filter, const CancellationToken& cancellation) {
+    return Submit([this, raw_query = std::move(raw_query), filter, cancellation] {
+        // запрос, отмененный в очереди, не разбирается
+        cancellation.ThrowIfCancelled();
+        PreparedQuery query = search_server_.PrepareQuery(raw_query);
+        query.cancellation = cancellation;
+        return search_server_.FindTopDocuments(query, filter);
+        });
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::FindTopDocuments(PreparedQuery query, const DocumentFilter& filter) {
+    return Submit([this, query = std::move(query), filter] {
+        query.cancellation.ThrowIfCancelled();
+        return search_server_.FindTopDocuments(query, filter);
+        });
+}
+
+std::future<std::tuple<std::vector<std::string_view>, DocumentStatus>> AsyncSearchServer::MatchDocument(std::string raw_query, int document_id, const CancellationToken& cancellation) {
+    // найденные слова ссылаются на словарь сервера, а не на текст запроса
+    return Submit([this, raw_query = std::move(raw_query), document_id, cancellation] {
+        cancellation.ThrowIfCancelled();
+        PreparedQuery query = search_server_.PrepareQuery(raw_query);
+        query.cancellation = cancellation;
+        return search_server_.MatchDocument(query, document_id);
+        });
+}
+
+std::future<std::tuple<std::vector<std::string_view>, DocumentStatus>> AsyncSearchServer::MatchDocument(PreparedQuery query, int document_id) {
+    return Submit([this, query = std::move(query), document_id] {
+        query.cancellation.ThrowIfCancelled();
+        return search_server_.MatchDocument(query, document_id);
+        });
+}
+
+QueryStream AsyncSearchServer::ProcessQueries(std::vector<std::string> queries, const DocumentFilter& filter) {
+    auto state = std::make_shared<QueryStream::State>();
+    state->remaining = queries.size();
+    CancellationSource cancellation;
+    const CancellationToken token = cancellation.GetToken();
+    for (size_t index = 0; index < queries.size(); ++index) {
+        pool_.Submit([this, state, index, raw_query = std::move(queries[index]), filter, token] {
+            QueryStreamItem item;
+            item.index = index;
+            try {
+                token.ThrowIfCancelled();
+                PreparedQuery query = search_server_.PrepareQuery(raw_query);
+                query.cancellation = token;
+                item.documents = search_server_.FindTopDocuments(query, filter);
+            }
+            catch (...) {
+                item.error = std::current_exception();
+            }
+            {
+                std::lock_guard lock(state->mutex);
+                state->items.push_back(std::move(item));
+                --state->remaining;
+            }
+            state->ready.notify_all();
+            });
+    }
+    return QueryStream(state, queries.size(), std::move(cancellation));
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "search_server.h"
+#include "cancellation.h"
+#include "document_filter.h"
+#include "thread_pool.h"
+
+// результат одного запроса пакета: index - номер запроса в пакете,
+// error - исключение запроса (например, QueryCancelledError)
+struct QueryStreamItem {
+    size_t index = 0;
+    std::vector<Document> documents;
+    std::exception_ptr error;
+};
+
+// результаты пакета запросов в порядке их готовности
+class QueryStream {
+public:
+    // следующий готовый результат, ждет его при необходимости; nullopt - все результаты выданы
+    std::optional<QueryStreamItem> Next();
+
+    size_t GetQueryCount() const;
+
+    // отмена запросов пакета, которые еще не завершились
+    void Cancel();
+
+private:
+    friend class AsyncSearchServer;
+
+    struct State {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<QueryStreamItem> items;
+        size_t remaining = 0;
+    };
+
+    QueryStream(std::shared_ptr<State> state, size_t query_count, CancellationSource cancellation);
+
+    std::shared_ptr<State> state_;
+    size_t query_count_;
+    CancellationSource cancellation_;
+};
+
+// асинхронный поиск: запросы выполняются в собственном пуле потоков, вызывающий получает
+// std::future. Сервер не должен изменяться, пока выполняются запросы, и должен пережить
+// AsyncSearchServer; деструктор дожидается уже поставленных запросов
+class AsyncSearchServer {
+public:
+    explicit AsyncSearchServer(const SearchServer& search_server, size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+
+    std::future<std::vector<Document>> FindTopDocuments(std::string raw_query, const CancellationToken& cancellation = {});
+    std::future<std::vector<Document>> FindTopDocuments(std::string raw_query, const DocumentFilter& filter, const CancellationToken& cancellation = {});
+
+    // отмена задается полем cancellation запроса
+    std::future<std::vector<Document>> FindTopDocuments(PreparedQuery query, const DocumentFilter& filter = {});
+
+    std::future<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocument(std::string raw_query, int document_id, const CancellationToken& cancellation = {});
+
+    // отмена задается полем cancellation запроса
+    std::future<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocument(PreparedQuery query, int document_id);
+
+    // пакет запросов, результаты выдаются по мере готовности
+    QueryStream ProcessQueries(std::vector<std::string> queries, const DocumentFilter& filter = {});
+
+private:
+    const SearchServer& search_server_;
+    ThreadPool pool_;
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(Function function);
+};
+
+template <typename Function>
+std::future<std::invoke_result_t<Function>> AsyncSearchServer::Submit(Function function) {
+    // std::function требует копируемой задачи, поэтому promise хранится в shared_ptr
+    auto promise = std::make_shared<std::promise<std::invoke_result_t<Function>>>();
+    auto future = promise->get_future();
+    pool_.Submit([promise, function = std::move(function)]() mutable {
+        try {
+            promise->set_value(function());
+        }
+        catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+        });
+    return future;
+}
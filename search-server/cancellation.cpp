@@ -0,0 +1,32 @@
+#include "cancellation.h"
+
+QueryCancelledError::QueryCancelledError() : std::runtime_error("query cancelled") {
+}
+
+CancellationToken::CancellationToken(std::shared_ptr<const std::atomic<bool>> state) : state_(std::move(state)) {
+}
+
+bool CancellationToken::IsCancelled() const {
+    return state_ && state_->load(std::memory_order_relaxed);
+}
+
+void CancellationToken::ThrowIfCancelled() const {
+    if (IsCancelled()) {
+        throw QueryCancelledError();
+    }
+}
+
+CancellationSource::CancellationSource() : state_(std::make_shared<std::atomic<bool>>(false)) {
+}
+
+CancellationToken CancellationSource::GetToken() const {
+    return CancellationToken(state_);
+}
+
+void CancellationSource::Cancel() {
+    state_->store(true, std::memory_order_relaxed);
+}
+
+bool CancellationSource::IsCancelled() const {
+    return state_->load(std::memory_order_relaxed);
+}
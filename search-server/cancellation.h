@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+// исключение, которым прерывается отмененный запрос
+class QueryCancelledError : public std::runtime_error {
+public:
+    QueryCancelledError();
+};
+
+// признак отмены запроса. Токен по умолчанию никогда не отменяется
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool IsCancelled() const;
+    void ThrowIfCancelled() const;
+
+private:
+    friend class CancellationSource;
+
+    explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> state);
+
+    std::shared_ptr<const std::atomic<bool>> state_;
+};
+
+// источник отмены: Cancel() отменяет все выданные им токены
+class CancellationSource {
+public:
+    CancellationSource();
+
+    CancellationToken GetToken() const;
+    void Cancel();
+    bool IsCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> state_;
+};
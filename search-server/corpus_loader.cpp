@@ -0,0 +1,166 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <libgen.h>
+#include <memory>
+#include <system_error>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "corpus_loader.h"
+#include "mapped_file.h"
+
+namespace {
+
+// следующее поле строки до символа табуляции
+std::string_view NextField(std::string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == std::string_view::npos) {
+        throw std::invalid_argument("expected tab-separated fields");
+    }
+    const std::string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+int ParseNumber(std::string_view text) {
+    int value = 0;
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        throw std::invalid_argument("expected a number");
+    }
+    return value;
+}
+
+void ParseRatings(std::string_view text, std::vector<int>& ratings) {
+    ratings.clear();
+    while (!text.empty()) {
+        const size_t comma = std::min(text.size(), text.find(','));
+        ratings.push_back(ParseNumber(text.substr(0, comma)));
+        text.remove_prefix(std::min(text.size(), comma + 1));
+    }
+}
+
+// количество повторов каждого слова документа, дающее его TF: наименьшее k, при котором
+// все tf * k целые. Кратно 1 / min_tf, так как слово с наименьшим TF встречается хотя бы раз
+std::vector<int> RestoreWordCounts(const WordFrequenciesView& words) {
+    const double EPSILON = 1e-6;
+    double min_frequency = 1.0;
+    for (const auto& [word, frequency] : words) {
+        min_frequency = std::min(min_frequency, frequency);
+    }
+    const long base = std::max(1L, std::lround(1.0 / min_frequency));
+    std::vector<int> counts;
+    for (long total = base; ; total += base) {
+        counts.clear();
+        for (const auto& [word, frequency] : words) {
+            const double count = frequency * total;
+            if (std::abs(count - std::round(count)) > EPSILON * total) {
+                break;
+            }
+            counts.push_back(static_cast<int>(std::lround(count)));
+        }
+        if (counts.size() == words.size()) {
+            return counts;
+        }
+    }
+}
+
+void SyncDirectory(const std::string& path) {
+    std::string copy = path;
+    const int fd = open(dirname(copy.data()), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+} // namespace
+
+size_t LoadCorpus(SearchServer& search_server, const std::string& path) {
+    const auto corpus = std::make_shared<const MappedFile>(path);
+    const std::shared_ptr<const void> storage = corpus;
+    std::string_view data = corpus->GetData();
+
+    size_t document_count = 0;
+    size_t line_number = 0;
+    // вектор рейтингов переиспользуется для всех строк
+    std::vector<int> ratings;
+    while (!data.empty()) {
+        const size_t end = std::min(data.size(), data.find('\n'));
+        std::string_view line = data.substr(0, end);
+        data.remove_prefix(std::min(data.size(), end + 1));
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            const int document_id = ParseNumber(NextField(line));
+            const DocumentStatus status = ParseDocumentStatus(NextField(line));
+            ParseRatings(NextField(line), ratings);
+            search_server.AddDocument(document_id, line, status, ratings, storage);
+        }
+        catch (const std::invalid_argument& e) {
+            corpus->EndSequentialRead();
+            throw std::invalid_argument(path + ":" + std::to_string(line_number) + ": " + e.what());
+        }
+        ++document_count;
+    }
+    // сервер держит отображение и читает из него тексты документов вразбивку
+    corpus->EndSequentialRead();
+    return document_count;
+}
+
+size_t SaveCorpus(const SearchServer& search_server, const std::string& path) {
+    const std::string temporary_path = path + ".tmp";
+    FILE* file = std::fopen(temporary_path.c_str(), "w");
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + temporary_path);
+    }
+    size_t document_count = 0;
+    std::string line;
+    for (const int document_id : search_server) {
+        line.clear();
+        line += std::to_string(document_id);
+        line += '\t';
+        line += GetStatusName(search_server.GetDocumentStatus(document_id));
+        line += '\t';
+        line += std::to_string(search_server.GetDocumentRating(document_id));
+        line += '\t';
+        if (search_server.HasDocumentText(document_id)) {
+            line += search_server.GetDocumentText(document_id);
+            line += '\n';
+            std::fwrite(line.data(), 1, line.size(), file);
+            ++document_count;
+            continue;
+        }
+        const WordFrequenciesView words = search_server.GetWordFrequencies(document_id);
+        const std::vector<int> counts = RestoreWordCounts(words);
+        size_t index = 0;
+        for (const auto& [word, frequency] : words) {
+            for (int i = 0; i < counts[index]; ++i) {
+                line += word;
+                line += ' ';
+            }
+            ++index;
+        }
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), file);
+        ++document_count;
+    }
+    const bool written = std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    const int error = errno;
+    std::fclose(file);
+    if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        throw std::system_error(written ? errno : error, std::generic_category(), "cannot write " + path);
+    }
+    SyncDirectory(path);
+    return document_count;
+}
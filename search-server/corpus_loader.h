@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+#include "search_server.h"
+
+// загрузка корпуса документов из файла, отображенного в память. Одна строка - один документ:
+//   <id>\t<status>\t<ratings>\t<text>
+// статус задается именем (ACTUAL, IRRELEVANT, BANNED, REMOVED), рейтинги - через запятую
+// (поле может быть пустым). Слова разбираются прямо из отображения, сервер держит файл
+// отображенным до своего уничтожения, и словарь ссылается на него без копирования.
+// Возвращает количество загруженных документов
+size_t LoadCorpus(SearchServer& search_server, const std::string& path);
+
+// запись индекса в файл того же формата (снимок). Текст берется из хранилища документов,
+// а без него восстанавливается из прямого индекса: слова повторяются столько раз, чтобы
+// получились те же TF. Рейтинг записывается средним. Файл пишется во временный и атомарно
+// переименовывается. Возвращает количество записанных документов
+size_t SaveCorpus(const SearchServer& search_server, const std::string& path);
@@ -1,7 +1,23 @@
 #include <iostream>
+#include <stdexcept>
 
 #include "document.h"
 
+static const std::string_view STATUS_NAMES[DOCUMENT_STATUS_COUNT] = { "ACTUAL", "IRRELEVANT", "BANNED", "REMOVED" };
+
+std::string_view GetStatusName(DocumentStatus status) {
+    return STATUS_NAMES[static_cast<int>(status)];
+}
+
+DocumentStatus ParseDocumentStatus(std::string_view name) {
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (STATUS_NAMES[status] == name) {
+            return static_cast<DocumentStatus>(status);
+        }
+    }
+    throw std::invalid_argument("unknown document status");
+}
+
 Document::Document(int id, double relevance, int rating)
     : id(id), relevance(relevance), rating(rating) {}
 
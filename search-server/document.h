@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <string_view>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -8,6 +9,13 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// количество значений DocumentStatus
+const int DOCUMENT_STATUS_COUNT = 4;
+
+// имя статуса ("ACTUAL", "BANNED", ...) и разбор статуса по имени
+std::string_view GetStatusName(DocumentStatus status);
+DocumentStatus ParseDocumentStatus(std::string_view name);
+
 struct Document {
     Document() = default;
     Document(int id, double relevance, int rating);
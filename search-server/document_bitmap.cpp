@@ -0,0 +1,269 @@
+#include "document_bitmap.h"
+
+DocumentBitmap::DocumentBitmap(std::pmr::memory_resource* resource) : keys_(resource), containers_(resource) {
+}
+
+DocumentBitmap::Container::Container(std::pmr::memory_resource* resource) : array(resource), bits(resource) {
+}
+
+bool DocumentBitmap::Container::IsBitset() const {
+    return !bits.empty();
+}
+
+bool DocumentBitmap::Container::Contains(uint16_t low) const {
+    if (IsBitset()) {
+        return bits[low / WORD_BITS] >> (low % WORD_BITS) & 1;
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool DocumentBitmap::Container::Add(uint16_t low) {
+    if (IsBitset()) {
+        const uint64_t bit = uint64_t{ 1 } << (low % WORD_BITS);
+        if (bits[low / WORD_BITS] & bit) {
+            return false;
+        }
+        bits[low / WORD_BITS] |= bit;
+        ++size;
+        return true;
+    }
+    const auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it != array.end() && *it == low) {
+        return false;
+    }
+    array.insert(it, low);
+    ++size;
+    if (size > ARRAY_MAX_SIZE) {
+        ToBitset();
+    }
+    return true;
+}
+
+bool DocumentBitmap::Container::Remove(uint16_t low) {
+    if (!Contains(low)) {
+        return false;
+    }
+    if (IsBitset()) {
+        bits[low / WORD_BITS] &= ~(uint64_t{ 1 } << (low % WORD_BITS));
+        --size;
+        if (size < BITSET_MIN_SIZE) {
+            ToArray();
+        }
+    }
+    else {
+        array.erase(std::lower_bound(array.begin(), array.end(), low));
+        --size;
+    }
+    return true;
+}
+
+void DocumentBitmap::Container::ToBitset() {
+    bits.assign(BITSET_WORDS, 0);
+    for (const uint16_t low : array) {
+        bits[low / WORD_BITS] |= uint64_t{ 1 } << (low % WORD_BITS);
+    }
+    array.clear();
+    array.shrink_to_fit();
+}
+
+void DocumentBitmap::Container::ToArray() {
+    array.clear();
+    array.reserve(size);
+    ForEachInRange(0, 0xFFFF, [&](uint16_t low) {
+        array.push_back(low);
+        });
+    bits.clear();
+    bits.shrink_to_fit();
+}
+
+void DocumentBitmap::Container::UnionWith(const Container& other) {
+    if (!IsBitset() && !other.IsBitset()) {
+        std::pmr::vector<uint16_t> merged(array.get_allocator().resource());
+        merged.reserve(array.size() + other.array.size());
+        std::set_union(array.begin(), array.end(), other.array.begin(), other.array.end(), std::back_inserter(merged));
+        array.swap(merged);
+        size = static_cast<uint32_t>(array.size());
+        if (size > ARRAY_MAX_SIZE) {
+            ToBitset();
+        }
+        return;
+    }
+    if (!IsBitset()) {
+        ToBitset();
+    }
+    if (other.IsBitset()) {
+        uint32_t count = 0;
+        for (int i = 0; i < BITSET_WORDS; ++i) {
+            bits[i] |= other.bits[i];
+            count += __builtin_popcountll(bits[i]);
+        }
+        size = count;
+    }
+    else {
+        for (const uint16_t low : other.array) {
+            const uint64_t bit = uint64_t{ 1 } << (low % WORD_BITS);
+            size += !(bits[low / WORD_BITS] & bit);
+            bits[low / WORD_BITS] |= bit;
+        }
+    }
+}
+
+void DocumentBitmap::Container::IntersectWith(const Container& other) {
+    if (IsBitset() && other.IsBitset()) {
+        uint32_t count = 0;
+        for (int i = 0; i < BITSET_WORDS; ++i) {
+            bits[i] &= other.bits[i];
+            count += __builtin_popcountll(bits[i]);
+        }
+        size = count;
+        if (size < BITSET_MIN_SIZE) {
+            ToArray();
+        }
+        return;
+    }
+    if (IsBitset()) {
+        // пересечение не больше массива other, поэтому результат - массив
+        std::pmr::vector<uint16_t> result(array.get_allocator().resource());
+        result.reserve(other.array.size());
+        std::copy_if(other.array.begin(), other.array.end(), std::back_inserter(result), [&](uint16_t low) {
+            return Contains(low);
+            });
+        bits.clear();
+        bits.shrink_to_fit();
+        array.swap(result);
+    }
+    else {
+        array.erase(std::remove_if(array.begin(), array.end(), [&](uint16_t low) {
+            return !other.Contains(low);
+            }), array.end());
+    }
+    size = static_cast<uint32_t>(array.size());
+}
+
+void DocumentBitmap::Add(int document_id) {
+    const uint16_t key = static_cast<uint32_t>(document_id) >> 16;
+    size_t index = FindContainer(key);
+    if (index == keys_.size() || keys_[index] != key) {
+        keys_.insert(keys_.begin() + index, key);
+        containers_.insert(containers_.begin() + index, Container(GetResource()));
+    }
+    size_ += containers_[index].Add(static_cast<uint16_t>(document_id & 0xFFFF));
+}
+
+void DocumentBitmap::Remove(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    const uint16_t key = static_cast<uint32_t>(document_id) >> 16;
+    const size_t index = FindContainer(key);
+    if (index == keys_.size() || keys_[index] != key) {
+        return;
+    }
+    size_ -= containers_[index].Remove(static_cast<uint16_t>(document_id & 0xFFFF));
+    if (containers_[index].size == 0) {
+        keys_.erase(keys_.begin() + index);
+        containers_.erase(containers_.begin() + index);
+    }
+}
+
+bool DocumentBitmap::Contains(int document_id) const {
+    if (document_id < 0) {
+        return false;
+    }
+    const uint16_t key = static_cast<uint32_t>(document_id) >> 16;
+    const size_t index = FindContainer(key);
+    return index < keys_.size() && keys_[index] == key && containers_[index].Contains(static_cast<uint16_t>(document_id & 0xFFFF));
+}
+
+size_t DocumentBitmap::Size() const {
+    return size_;
+}
+
+bool DocumentBitmap::Empty() const {
+    return size_ == 0;
+}
+
+void DocumentBitmap::UnionWith(const DocumentBitmap& other) {
+    for (size_t i = 0; i < other.keys_.size(); ++i) {
+        const size_t index = FindContainer(other.keys_[i]);
+        if (index == keys_.size() || keys_[index] != other.keys_[i]) {
+            Container copy(GetResource());
+            copy.array.assign(other.containers_[i].array.begin(), other.containers_[i].array.end());
+            copy.bits.assign(other.containers_[i].bits.begin(), other.containers_[i].bits.end());
+            copy.size = other.containers_[i].size;
+            keys_.insert(keys_.begin() + index, other.keys_[i]);
+            containers_.insert(containers_.begin() + index, std::move(copy));
+        }
+        else {
+            containers_[index].UnionWith(other.containers_[i]);
+        }
+    }
+    size_ = 0;
+    for (const Container& container : containers_) {
+        size_ += container.size;
+    }
+}
+
+void DocumentBitmap::IntersectWith(const DocumentBitmap& other) {
+    size_t kept = 0;
+    size_ = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        const size_t index = other.FindContainer(keys_[i]);
+        if (index == other.keys_.size() || other.keys_[index] != keys_[i]) {
+            continue;
+        }
+        containers_[i].IntersectWith(other.containers_[index]);
+        if (containers_[i].size == 0) {
+            continue;
+        }
+        size_ += containers_[i].size;
+        if (kept != i) {
+            keys_[kept] = keys_[i];
+            containers_[kept] = std::move(containers_[i]);
+        }
+        ++kept;
+    }
+    keys_.erase(keys_.begin() + kept, keys_.end());
+    containers_.erase(containers_.begin() + kept, containers_.end());
+}
+
+size_t DocumentBitmap::GetAllocatedBytes() const {
+    size_t bytes = keys_.capacity() * sizeof(uint16_t) + containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        bytes += container.array.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+size_t DocumentBitmap::GetAllocatedBytesAfterAdd(int document_id) const {
+    const size_t bytes = GetAllocatedBytes();
+    const uint16_t key = static_cast<uint32_t>(document_id) >> 16;
+    const size_t index = FindContainer(key);
+    if (index == keys_.size() || keys_[index] != key) {
+        // новый контейнер - массив из одного элемента
+        return bytes + (GrowCapacity(keys_.size(), keys_.capacity()) - keys_.capacity()) * sizeof(uint16_t)
+            + (GrowCapacity(containers_.size(), containers_.capacity()) - containers_.capacity()) * sizeof(Container)
+            + sizeof(uint16_t);
+    }
+    const Container& container = containers_[index];
+    const uint16_t low = static_cast<uint16_t>(document_id & 0xFFFF);
+    if (container.IsBitset() || container.Contains(low)) {
+        return bytes;
+    }
+    if (container.size + 1 > ARRAY_MAX_SIZE) {
+        return bytes - container.array.capacity() * sizeof(uint16_t) + BITSET_WORDS * sizeof(uint64_t);
+    }
+    return bytes + (GrowCapacity(container.array.size(), container.array.capacity()) - container.array.capacity()) * sizeof(uint16_t);
+}
+
+size_t DocumentBitmap::GrowCapacity(size_t size, size_t capacity) {
+    return size < capacity ? capacity : size + std::max<size_t>(size, 1);
+}
+
+std::pmr::memory_resource* DocumentBitmap::GetResource() const {
+    return keys_.get_allocator().resource();
+}
+
+size_t DocumentBitmap::FindContainer(uint16_t key) const {
+    return std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin();
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// сжатое множество id документов в духе Roaring: id делится на старшие и младшие 16 бит,
+// для каждого значения старших бит хранится контейнер младших - отсортированный массив,
+// пока в нем не больше ARRAY_MAX_SIZE элементов, иначе битовая карта на 65536 бит.
+// Битовая карта снова становится массивом, только когда в ней меньше BITSET_MIN_SIZE элементов,
+// чтобы добавление и удаление на границе не переключали представление каждый раз.
+// Объединение и пересечение битовых карт идут по 64-битным словам и векторизуются компилятором
+class DocumentBitmap {
+public:
+    DocumentBitmap() = default;
+
+    // память под контейнеры берется из переданного ресурса (например, из арены запроса)
+    explicit DocumentBitmap(std::pmr::memory_resource* resource);
+
+    void Add(int document_id);
+    void Remove(int document_id);
+    bool Contains(int document_id) const;
+
+    // количество документов в множестве
+    size_t Size() const;
+    bool Empty() const;
+
+    void UnionWith(const DocumentBitmap& other);
+    void IntersectWith(const DocumentBitmap& other);
+
+    // объем памяти, выделенной под контейнеры
+    size_t GetAllocatedBytes() const;
+    // объем памяти после Add(document_id)
+    size_t GetAllocatedBytesAfterAdd(int document_id) const;
+
+    // обход id из диапазона [first_id, last_id] по возрастанию
+    template <typename Function>
+    void ForEachInRange(int first_id, int last_id, Function function) const;
+
+private:
+    static const int ARRAY_MAX_SIZE = 4096;
+    static const int BITSET_MIN_SIZE = ARRAY_MAX_SIZE / 2;
+    static const int BITSET_WORDS = 1024;
+    static const int WORD_BITS = 64;
+
+    struct Container {
+        explicit Container(std::pmr::memory_resource* resource);
+
+        // непусто только одно представление: массив младших бит или битовая карта
+        std::pmr::vector<uint16_t> array;
+        std::pmr::vector<uint64_t> bits;
+        uint32_t size = 0;
+
+        bool IsBitset() const;
+        bool Contains(uint16_t low) const;
+        bool Add(uint16_t low);
+        bool Remove(uint16_t low);
+        void ToBitset();
+        void ToArray();
+
+        void UnionWith(const Container& other);
+        void IntersectWith(const Container& other);
+
+        template <typename Function>
+        void ForEachInRange(uint32_t first_low, uint32_t last_low, Function function) const;
+    };
+
+    std::pmr::vector<uint16_t> keys_;
+    std::pmr::vector<Container> containers_;
+    size_t size_ = 0;
+
+    std::pmr::memory_resource* GetResource() const;
+
+    // емкость вектора после вставки одного элемента
+    static size_t GrowCapacity(size_t size, size_t capacity);
+
+    // индекс контейнера с ключом key или позиция для его вставки
+    size_t FindContainer(uint16_t key) const;
+};
+
+template <typename Function>
+void DocumentBitmap::Container::ForEachInRange(uint32_t first_low, uint32_t last_low, Function function) const {
+    if (!IsBitset()) {
+        for (auto it = std::lower_bound(array.begin(), array.end(), first_low); it != array.end() && *it <= last_low; ++it) {
+            function(*it);
+        }
+        return;
+    }
+    for (uint32_t i = first_low / WORD_BITS; i <= last_low / WORD_BITS; ++i) {
+        uint64_t word = bits[i];
+        while (word) {
+            const uint32_t low = i * WORD_BITS + __builtin_ctzll(word);
+            if (low > last_low) {
+                return;
+            }
+            if (low >= first_low) {
+                function(static_cast<uint16_t>(low));
+            }
+            word &= word - 1;
+        }
+    }
+}
+
+template <typename Function>
+void DocumentBitmap::ForEachInRange(int first_id, int last_id, Function function) const {
+    if (first_id < 0) {
+        first_id = 0;
+    }
+    if (last_id < first_id) {
+        return;
+    }
+    const uint16_t first_key = static_cast<uint32_t>(first_id) >> 16;
+    const uint16_t last_key = static_cast<uint32_t>(last_id) >> 16;
+    for (size_t i = FindContainer(first_key); i < keys_.size() && keys_[i] <= last_key; ++i) {
+        const uint32_t high = static_cast<uint32_t>(keys_[i]) << 16;
+        const uint32_t first_low = keys_[i] == first_key ? static_cast<uint32_t>(first_id) & 0xFFFF : 0;
+        const uint32_t last_low = keys_[i] == last_key ? static_cast<uint32_t>(last_id) & 0xFFFF : 0xFFFF;
+        containers_[i].ForEachInRange(first_low, last_low, [&](uint16_t low) {
+            function(static_cast<int>(high | low));
+            });
+    }
+}
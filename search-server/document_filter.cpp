@@ -0,0 +1,32 @@
+#include "document_filter.h"
+
+DocumentFilter::DocumentFilter(std::initializer_list<DocumentStatus> statuses) {
+    for (const DocumentStatus status : statuses) {
+        AddStatus(status);
+    }
+}
+
+DocumentFilter DocumentFilter::AnyStatus() {
+    DocumentFilter filter({});
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        filter.AddStatus(static_cast<DocumentStatus>(status));
+    }
+    return filter;
+}
+
+void DocumentFilter::AddStatus(DocumentStatus status) {
+    status_mask |= 1u << static_cast<int>(status);
+}
+
+bool DocumentFilter::HasStatus(DocumentStatus status) const {
+    return status_mask >> static_cast<int>(status) & 1u;
+}
+
+bool DocumentFilter::HasAllStatuses() const {
+    return status_mask == (1u << DOCUMENT_STATUS_COUNT) - 1;
+}
+
+bool DocumentFilter::Accepts(int document_id, DocumentStatus status, int rating) const {
+    return HasStatus(status) && min_rating <= rating && rating <= max_rating
+        && min_id <= document_id && document_id <= max_id;
+}
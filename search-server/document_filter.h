@@ -0,0 +1,27 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <initializer_list>
+
+#include "document.h"
+
+// структурированный фильтр документов, который сервер применяет прямо при обходе индекса:
+// набор допустимых статусов, диапазон рейтинга и диапазон id (границы включаются)
+struct DocumentFilter {
+    DocumentFilter(std::initializer_list<DocumentStatus> statuses = { DocumentStatus::ACTUAL });
+
+    // фильтр, пропускающий документы с любым статусом
+    static DocumentFilter AnyStatus();
+
+    void AddStatus(DocumentStatus status);
+    bool HasStatus(DocumentStatus status) const;
+    bool HasAllStatuses() const;
+
+    bool Accepts(int document_id, DocumentStatus status, int rating) const;
+
+    uint32_t status_mask = 0;
+    int min_rating = INT_MIN;
+    int max_rating = INT_MAX;
+    int min_id = 0;
+    int max_id = INT_MAX;
+};
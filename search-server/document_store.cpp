@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "document_store.h"
+#include "lz_codec.h"
+
+DocumentStore::DocumentStore(size_t block_size) : block_size_(block_size) {
+    if (block_size == 0) {
+        throw std::invalid_argument("block size must be positive");
+    }
+}
+
+void DocumentStore::Add(uint32_t slot, std::string_view text) {
+    if (text.size() > UINT32_MAX) {
+        throw std::length_error("document text is too long");
+    }
+    Remove(slot);
+    if (slot >= locations_.size()) {
+        locations_.resize(static_cast<size_t>(slot) + 1);
+    }
+    // длинный текст не делит блок с предыдущими, чтобы чтение коротких не распаковывало его
+    if (!open_block_.empty() && open_block_.size() + text.size() > block_size_) {
+        SealOpenBlock();
+    }
+    locations_[slot] = { static_cast<uint32_t>(blocks_.size()), static_cast<uint32_t>(open_block_.size()), static_cast<uint32_t>(text.size()) };
+    open_block_.append(text);
+    ++document_count_;
+    text_bytes_ += text.size();
+    if (open_block_.size() >= block_size_) {
+        SealOpenBlock();
+    }
+}
+
+void DocumentStore::Remove(uint32_t slot) {
+    if (!Contains(slot)) {
+        return;
+    }
+    Location& location = locations_[slot];
+    removed_bytes_ += location.size;
+    text_bytes_ -= location.size;
+    --document_count_;
+    location = Location{};
+    if (removed_bytes_ > block_size_ && removed_bytes_ > text_bytes_) {
+        Compact();
+    }
+}
+
+bool DocumentStore::Contains(uint32_t slot) const {
+    return slot < locations_.size() && locations_[slot].block != NO_BLOCK;
+}
+
+std::string DocumentStore::Get(uint32_t slot) const {
+    if (!Contains(slot)) {
+        throw std::out_of_range("document text is not stored");
+    }
+    const Location& location = locations_[slot];
+    std::string buffer;
+    return std::string(GetBlockText(location.block, location.offset + location.size, buffer).substr(location.offset, location.size));
+}
+
+std::vector<std::string> DocumentStore::Get(const std::vector<uint32_t>& slots) const {
+    for (const uint32_t slot : slots) {
+        if (!Contains(slot)) {
+            throw std::out_of_range("document text is not stored");
+        }
+    }
+    // документы группируются по блокам
+    std::vector<size_t> order(slots.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return locations_[slots[lhs]].block < locations_[slots[rhs]].block;
+        });
+    std::vector<std::string> texts(slots.size());
+    std::string buffer;
+    for (size_t group = 0; group < order.size();) {
+        const uint32_t block = locations_[slots[order[group]]].block;
+        size_t group_end = group;
+        size_t block_limit = 0;
+        for (; group_end < order.size() && locations_[slots[order[group_end]]].block == block; ++group_end) {
+            const Location& location = locations_[slots[order[group_end]]];
+            block_limit = std::max<size_t>(block_limit, location.offset + location.size);
+        }
+        const std::string_view block_text = GetBlockText(block, block_limit, buffer);
+        for (; group < group_end; ++group) {
+            const Location& location = locations_[slots[order[group]]];
+            texts[order[group]] = std::string(block_text.substr(location.offset, location.size));
+        }
+    }
+    return texts;
+}
+
+size_t DocumentStore::GetDocumentCount() const {
+    return document_count_;
+}
+
+size_t DocumentStore::GetTextBytes() const {
+    return text_bytes_;
+}
+
+size_t DocumentStore::GetStoredBytes() const {
+    size_t bytes = open_block_.size();
+    for (const Block& block : blocks_) {
+        bytes += block.data.size();
+    }
+    return bytes;
+}
+
+size_t DocumentStore::GetAllocatedBytes() const {
+    size_t bytes = open_block_.capacity() + blocks_.capacity() * sizeof(Block) + locations_.capacity() * sizeof(Location);
+    for (const Block& block : blocks_) {
+        bytes += block.data.capacity();
+    }
+    return bytes;
+}
+
+size_t DocumentStore::GetAllocatedBytesAfterAdd(uint32_t slot, std::string_view text) const {
+    // вектор и строка без запаса емкости растут не меньше чем вдвое
+    const auto grow = [](size_t size, size_t capacity, size_t required) {
+        return required <= capacity ? capacity : std::max(required, std::max(capacity, size) * 2);
+    };
+    size_t bytes = GetAllocatedBytes();
+    if (slot >= locations_.size()) {
+        bytes += (grow(locations_.size(), locations_.capacity(), static_cast<size_t>(slot) + 1) - locations_.capacity()) * sizeof(Location);
+    }
+    size_t open_size = open_block_.size();
+    size_t new_block_count = 0;
+    if (open_size > 0 && open_size + text.size() > block_size_) {
+        bytes += LzCompressBound(open_size);
+        ++new_block_count;
+        open_size = 0;
+    }
+    open_size += text.size();
+    bytes += grow(open_block_.size(), open_block_.capacity(), open_size) - open_block_.capacity();
+    if (open_size >= block_size_) {
+        bytes += LzCompressBound(open_size);
+        ++new_block_count;
+    }
+    if (new_block_count > 0) {
+        bytes += (grow(blocks_.size(), blocks_.capacity(), blocks_.size() + new_block_count) - blocks_.capacity()) * sizeof(Block);
+    }
+    return bytes;
+}
+
+void DocumentStore::SealOpenBlock() {
+    if (blocks_.size() >= NO_BLOCK) {
+        throw std::length_error("too many document store blocks");
+    }
+    Block block;
+    block.data = LzCompress(open_block_);
+    block.data.shrink_to_fit();
+    blocks_.push_back(std::move(block));
+    open_block_.clear();
+}
+
+void DocumentStore::Compact() {
+    std::vector<uint32_t> slots;
+    slots.reserve(document_count_);
+    for (size_t slot = 0; slot < locations_.size(); ++slot) {
+        if (locations_[slot].block != NO_BLOCK) {
+            slots.push_back(static_cast<uint32_t>(slot));
+        }
+    }
+    const std::vector<std::string> texts = Get(slots);
+    DocumentStore store(block_size_);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        store.Add(slots[i], texts[i]);
+    }
+    *this = std::move(store);
+}
+
+std::string_view DocumentStore::GetBlockText(uint32_t block, size_t limit, std::string& buffer) const {
+    if (block == blocks_.size()) {
+        return open_block_;
+    }
+    buffer.clear();
+    LzDecompress(blocks_[block].data, buffer, limit);
+    return buffer;
+}
+
+Snippet MakeSnippet(int document_id, std::string_view text, const std::vector<std::string_view>& words, size_t max_length) {
+    struct Token {
+        size_t begin;
+        size_t end;
+        bool matched;
+    };
+    std::vector<std::string_view> sorted_words(words);
+    std::sort(sorted_words.begin(), sorted_words.end());
+    std::vector<Token> tokens;
+    for (size_t pos = text.find_first_not_of(' '); pos < text.size(); pos = text.find_first_not_of(' ', pos)) {
+        const size_t end = std::min(text.find(' ', pos), text.size());
+        tokens.push_back({ pos, end, std::binary_search(sorted_words.begin(), sorted_words.end(), text.substr(pos, end - pos)) });
+        pos = end;
+    }
+
+    Snippet snippet;
+    snippet.document_id = document_id;
+    if (tokens.empty()) {
+        return snippet;
+    }
+    // окно слов [first, last] с наибольшим количеством совпадений
+    size_t best_first = 0;
+    size_t best_last = 0;
+    size_t best_count = 0;
+    size_t count = 0;
+    for (size_t first = 0, last = 0; last < tokens.size(); ++last) {
+        count += tokens[last].matched;
+        while (first < last && tokens[last].end - tokens[first].begin > max_length) {
+            count -= tokens[first++].matched;
+        }
+        if (count > best_count) {
+            best_count = count;
+            best_first = first;
+            best_last = last;
+        }
+    }
+    // оставшееся место заполняется соседними словами
+    while (best_last + 1 < tokens.size() && tokens[best_last + 1].end - tokens[best_first].begin <= max_length) {
+        ++best_last;
+    }
+    while (best_first > 0 && tokens[best_last].end - tokens[best_first - 1].begin <= max_length) {
+        --best_first;
+    }
+
+    const size_t begin = tokens[best_first].begin;
+    snippet.text = std::string(text.substr(begin, tokens[best_last].end - begin));
+    for (size_t i = best_first; i <= best_last; ++i) {
+        if (tokens[i].matched) {
+            snippet.highlights.emplace_back(tokens[i].begin - begin, tokens[i].end - tokens[i].begin);
+        }
+    }
+    snippet.truncated_front = best_first > 0;
+    snippet.truncated_back = best_last + 1 < tokens.size();
+    return snippet;
+}
+
+std::string HighlightSnippet(const Snippet& snippet, std::string_view open, std::string_view close) {
+    std::string result;
+    result.reserve(snippet.text.size() + snippet.highlights.size() * (open.size() + close.size()) + 8);
+    if (snippet.truncated_front) {
+        result += "... ";
+    }
+    size_t pos = 0;
+    for (const auto& [begin, length] : snippet.highlights) {
+        result.append(snippet.text, pos, begin - pos);
+        result.append(open);
+        result.append(snippet.text, begin, length);
+        result.append(close);
+        pos = begin + length;
+    }
+    result.append(snippet.text, pos);
+    if (snippet.truncated_back) {
+        result += " ...";
+    }
+    return result;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// хранилище исходных текстов документов. Тексты дописываются в открытый блок, заполненный
+// блок сжимается кодеком LzCompress. Расположение текста (блок, смещение, длина) лежит
+// в таблице, индекс которой - внутренний номер документа, выданный владельцем хранилища
+// (номера плотные), поэтому поиск блока занимает O(1), а чтение распаковывает один блок. Удаленные тексты освобождаются пересборкой, когда они занимают
+// больше половины хранилища
+class DocumentStore {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 8 * 1024;
+
+    explicit DocumentStore(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    // текст существующего номера заменяется
+    void Add(uint32_t slot, std::string_view text);
+    void Remove(uint32_t slot);
+
+    bool Contains(uint32_t slot) const;
+
+    // для отсутствующего номера - std::out_of_range
+    std::string Get(uint32_t slot) const;
+    // тексты нескольких документов; каждый блок распаковывается один раз
+    std::vector<std::string> Get(const std::vector<uint32_t>& slots) const;
+
+    size_t GetDocumentCount() const;
+    // объем хранимых текстов без сжатия и после сжатия (открытый блок не сжат)
+    size_t GetTextBytes() const;
+    size_t GetStoredBytes() const;
+    size_t GetAllocatedBytes() const;
+    // оценка сверху объема памяти после Add(slot, text): заполненный блок
+    // считается несжимаемым
+    size_t GetAllocatedBytesAfterAdd(uint32_t slot, std::string_view text) const;
+
+private:
+    static const uint32_t NO_BLOCK = UINT32_MAX;
+
+    struct Location {
+        uint32_t block = NO_BLOCK;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // сжатый блок (размер исходного текста записан в начале данных)
+    struct Block {
+        std::string data;
+    };
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    // последний, еще не сжатый блок; его номер - blocks_.size()
+    std::string open_block_;
+    std::vector<Location> locations_;
+    size_t document_count_ = 0;
+    size_t text_bytes_ = 0;
+    size_t removed_bytes_ = 0;
+
+    void SealOpenBlock();
+    void Compact();
+    // текст блока не короче limit байт; сжатый блок распаковывается в buffer
+    std::string_view GetBlockText(uint32_t block, size_t limit, std::string& buffer) const;
+};
+
+// фрагмент текста документа с подсвеченными словами запроса
+struct Snippet {
+    int document_id = 0;
+    std::string text;
+    // подсвеченные слова: начало в text и длина
+    std::vector<std::pair<size_t, size_t>> highlights;
+    // фрагмент обрезан в начале или в конце текста
+    bool truncated_front = false;
+    bool truncated_back = false;
+};
+
+// фрагмент не длиннее max_length символов (кроме случая одного слова длиннее max_length),
+// содержащий наибольшее количество слов из words. Без совпадений - начало текста
+Snippet MakeSnippet(int document_id, std::string_view text, const std::vector<std::string_view>& words, size_t max_length);
+
+// фрагмент с подсвеченными словами между open и close и многоточиями на месте обрезанного текста
+std::string HighlightSnippet(const Snippet& snippet, std::string_view open = "[", std::string_view close = "]");
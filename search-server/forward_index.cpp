@@ -0,0 +1,77 @@
+#include "forward_index.h"
+
+WordFrequenciesView::WordFrequenciesView(const WordFrequency* first, const WordFrequency* last) : first_(first), last_(last) {
+}
+
+const WordFrequency* WordFrequenciesView::begin() const {
+    return first_;
+}
+
+const WordFrequency* WordFrequenciesView::end() const {
+    return last_;
+}
+
+size_t WordFrequenciesView::size() const {
+    return last_ - first_;
+}
+
+bool WordFrequenciesView::empty() const {
+    return first_ == last_;
+}
+
+const WordFrequency* WordFrequenciesView::find(std::string_view word) const {
+    const WordFrequency* it = std::lower_bound(first_, last_, word, [](const WordFrequency& entry, std::string_view value) {
+        return entry.word < value;
+        });
+    return it != last_ && it->word == word ? it : last_;
+}
+
+size_t WordFrequenciesView::count(std::string_view word) const {
+    return find(word) != last_;
+}
+
+size_t ForwardIndex::Remove(uint32_t slot) {
+    if (slot >= ranges_.size()) {
+        return 0;
+    }
+    const size_t size = ranges_[slot].size;
+    ranges_[slot] = Range{};
+    hole_size_ += size;
+    if (hole_size_ > pool_.size() / 2) {
+        Compact();
+    }
+    return size;
+}
+
+WordFrequenciesView ForwardIndex::Get(uint32_t slot) const {
+    if (slot >= ranges_.size()) {
+        return {};
+    }
+    const Range& range = ranges_[slot];
+    return { pool_.data() + range.offset, pool_.data() + range.offset + range.size };
+}
+
+size_t ForwardIndex::GetAllocatedBytes() const {
+    return pool_.capacity() * sizeof(WordFrequency) + ranges_.capacity() * sizeof(Range);
+}
+
+size_t ForwardIndex::GetAllocatedBytesAfterAdd(uint32_t slot, size_t word_count) const {
+    const size_t ranges_capacity = slot >= ranges_.size() ? GrowCapacity(ranges_.capacity(), static_cast<size_t>(slot) + 1) : ranges_.capacity();
+    return GrowCapacity(pool_.capacity(), pool_.size() + word_count) * sizeof(WordFrequency) + ranges_capacity * sizeof(Range);
+}
+
+size_t ForwardIndex::GrowCapacity(size_t capacity, size_t required) {
+    return required <= capacity ? capacity : std::max(required, capacity * 2);
+}
+
+void ForwardIndex::Compact() {
+    std::vector<WordFrequency> pool;
+    pool.reserve(pool_.size() - hole_size_);
+    for (Range& range : ranges_) {
+        const size_t offset = pool.size();
+        pool.insert(pool.end(), pool_.begin() + range.offset, pool_.begin() + range.offset + range.size);
+        range.offset = offset;
+    }
+    pool_.swap(pool);
+    hole_size_ = 0;
+}
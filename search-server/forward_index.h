@@ -0,0 +1,84 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+// частота слова в документе
+struct WordFrequency {
+    std::string_view word;
+    double frequency;
+};
+
+// представление слов документа, отсортированных по слову. Ссылается на память прямого
+// индекса и становится недействительным после добавления или удаления документа
+class WordFrequenciesView {
+public:
+    WordFrequenciesView() = default;
+    WordFrequenciesView(const WordFrequency* first, const WordFrequency* last);
+
+    const WordFrequency* begin() const;
+    const WordFrequency* end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // двоичный поиск слова, end() если слова в документе нет
+    const WordFrequency* find(std::string_view word) const;
+    size_t count(std::string_view word) const;
+
+private:
+    const WordFrequency* first_ = nullptr;
+    const WordFrequency* last_ = nullptr;
+};
+
+// прямой индекс: слова каждого документа хранятся непрерывным отсортированным отрезком
+// в общем пуле. Удаление оставляет в пуле дыру, пул уплотняется, когда дыры занимают
+// больше половины. Индекс - внутренний номер документа, который выдает владелец индекса:
+// номера плотные, поэтому таблица отрезков растет с количеством документов
+class ForwardIndex {
+public:
+    // words должны быть отсортированы по слову и не содержать повторов
+    template <typename Iterator>
+    void Add(uint32_t slot, Iterator first, Iterator last);
+
+    // возвращает количество слов удаленного документа
+    size_t Remove(uint32_t slot);
+
+    WordFrequenciesView Get(uint32_t slot) const;
+
+    // объем памяти, выделенной под пул и таблицу отрезков
+    size_t GetAllocatedBytes() const;
+    // объем памяти после добавления документа из word_count слов
+    size_t GetAllocatedBytesAfterAdd(uint32_t slot, size_t word_count) const;
+
+private:
+    struct Range {
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    std::vector<WordFrequency> pool_;
+    std::vector<Range> ranges_;
+    size_t hole_size_ = 0;
+
+    void Compact();
+
+    // емкость растет вдвое, чтобы рост памяти был предсказуем для оценки бюджета
+    static size_t GrowCapacity(size_t capacity, size_t required);
+};
+
+template <typename Iterator>
+void ForwardIndex::Add(uint32_t slot, Iterator first, Iterator last) {
+    if (slot >= ranges_.size()) {
+        ranges_.reserve(GrowCapacity(ranges_.capacity(), static_cast<size_t>(slot) + 1));
+        ranges_.resize(static_cast<size_t>(slot) + 1);
+    }
+    Remove(slot);
+    ranges_[slot].offset = pool_.size();
+    pool_.reserve(GrowCapacity(pool_.capacity(), pool_.size() + std::distance(first, last)));
+    pool_.insert(pool_.end(), first, last);
+    ranges_[slot].size = pool_.size() - ranges_[slot].offset;
+}
@@ -0,0 +1,149 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "load_generator.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ConnectionResult {
+    std::vector<double> latencies_us;
+    size_t error_count = 0;
+    // исключение потока соединения, бросается после завершения всех потоков
+    std::exception_ptr error;
+};
+
+int Connect(uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("cannot connect to query service");
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+}
+
+ConnectionResult RunConnection(uint16_t port, const std::vector<const std::string*>& requests, size_t pipeline_depth) {
+    ConnectionResult result;
+    result.latencies_us.reserve(requests.size());
+    const int fd = Connect(port);
+    std::deque<Clock::time_point> sent;
+    std::string input;
+    char buffer[64 * 1024];
+    size_t next = 0;
+    while (result.latencies_us.size() < requests.size()) {
+        // дозаполняем конвейер одной пачкой
+        std::string output;
+        while (next < requests.size() && sent.size() < pipeline_depth) {
+            output += *requests[next++];
+            output += '\n';
+            sent.push_back(Clock::now());
+        }
+        for (size_t offset = 0; offset < output.size();) {
+            const ssize_t size = send(fd, output.data() + offset, output.size() - offset, MSG_NOSIGNAL);
+            if (size <= 0) {
+                close(fd);
+                throw std::runtime_error("query service closed the connection");
+            }
+            offset += size;
+        }
+        const ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            close(fd);
+            throw std::runtime_error("query service closed the connection");
+        }
+        input.append(buffer, size);
+        size_t begin = 0;
+        for (size_t end = input.find('\n'); end != std::string::npos; end = input.find('\n', begin)) {
+            const auto now = Clock::now();
+            result.latencies_us.push_back(std::chrono::duration<double, std::micro>(now - sent.front()).count());
+            sent.pop_front();
+            if (input.compare(begin, 2, "OK") != 0) {
+                ++result.error_count;
+            }
+            begin = end + 1;
+        }
+        input.erase(0, begin);
+    }
+    close(fd);
+    return result;
+}
+
+} // namespace
+
+std::ostream& operator<<(std::ostream& out, const LoadReport& report) {
+    out << "requests = " << report.request_count << ", errors = " << report.error_count
+        << ", time = " << report.seconds << " s, throughput = " << report.requests_per_second << " req/s"
+        << ", latency p50 = " << report.p50_latency_us << " us, p99 = " << report.p99_latency_us
+        << " us, max = " << report.max_latency_us << " us";
+    return out;
+}
+
+LoadReport RunLoadGenerator(uint16_t port, const std::vector<std::string>& requests, size_t connection_count, size_t pipeline_depth) {
+    if (connection_count == 0 || pipeline_depth == 0) {
+        throw std::invalid_argument("connection count and pipeline depth must be positive");
+    }
+    std::vector<std::vector<const std::string*>> connection_requests(connection_count);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        connection_requests[i % connection_count].push_back(&requests[i]);
+    }
+
+    std::vector<ConnectionResult> results(connection_count);
+    const auto start = Clock::now();
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(connection_count);
+        for (size_t i = 0; i < connection_count; ++i) {
+            threads.emplace_back([&, i] {
+                try {
+                    results[i] = RunConnection(port, connection_requests[i], pipeline_depth);
+                }
+                catch (...) {
+                    results[i].error = std::current_exception();
+                }
+                });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    for (const ConnectionResult& result : results) {
+        if (result.error) {
+            std::rethrow_exception(result.error);
+        }
+    }
+    const auto finish = Clock::now();
+
+    LoadReport report;
+    std::vector<double> latencies;
+    for (const ConnectionResult& result : results) {
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+        report.error_count += result.error_count;
+    }
+    report.request_count = latencies.size();
+    report.seconds = std::chrono::duration<double>(finish - start).count();
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        report.requests_per_second = latencies.size() / report.seconds;
+        report.p50_latency_us = latencies[latencies.size() / 2];
+        report.p99_latency_us = latencies[latencies.size() * 99 / 100];
+        report.max_latency_us = latencies.back();
+    }
+    return report;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// отчет о нагрузочном прогоне: задержка измеряется клиентом от отправки команды до получения ответа
+struct LoadReport {
+    size_t request_count = 0;
+    size_t error_count = 0;
+    double seconds = 0.0;
+    double requests_per_second = 0.0;
+    double p50_latency_us = 0.0;
+    double p99_latency_us = 0.0;
+    double max_latency_us = 0.0;
+};
+
+std::ostream& operator<<(std::ostream& out, const LoadReport& report);
+
+// нагрузка на QueryService на локальном порту: connection_count соединений,
+// в каждом до pipeline_depth команд без ожидания ответа. Команды из requests
+// распределяются по соединениям по кругу. Ошибка соединения (сервис недоступен или закрыл
+// соединение) бросается как std::runtime_error после завершения всех соединений
+LoadReport RunLoadGenerator(uint16_t port, const std::vector<std::string>& requests, size_t connection_count, size_t pipeline_depth);
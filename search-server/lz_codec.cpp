@@ -0,0 +1,189 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "lz_codec.h"
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 0xFFFF;
+const int HASH_BITS = 12;
+const size_t LENGTH_NIBBLE_MAX = 15;
+// размер копирования "с запасом": лишние байты после конца отрезка перезаписываются следующими
+const size_t WILD_COPY_SIZE = 16;
+
+uint32_t Read32(const char* data) {
+    uint32_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t Hash(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void PutLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void PutSequence(std::string& out, std::string_view literals, size_t offset, size_t match_length) {
+    const size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+    const size_t literal_nibble = std::min(literals.size(), LENGTH_NIBBLE_MAX);
+    const size_t match_nibble = std::min(match_code, LENGTH_NIBBLE_MAX);
+    out.push_back(static_cast<char>(literal_nibble << 4 | match_nibble));
+    if (literal_nibble == LENGTH_NIBBLE_MAX) {
+        PutLength(out, literals.size() - LENGTH_NIBBLE_MAX);
+    }
+    out.append(literals);
+    if (match_length == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_nibble == LENGTH_NIBBLE_MAX) {
+        PutLength(out, match_code - LENGTH_NIBBLE_MAX);
+    }
+}
+
+void PutVarint(std::string& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+size_t GetVarint(const uint8_t*& in, const uint8_t* in_end) {
+    size_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in == in_end) {
+            break;
+        }
+        const uint8_t byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("compressed block has a bad size");
+}
+
+size_t GetLength(const uint8_t*& in, const uint8_t* in_end, size_t nibble) {
+    size_t length = nibble;
+    if (nibble != LENGTH_NIBBLE_MAX) {
+        return length;
+    }
+    uint8_t byte = 0;
+    do {
+        if (in == in_end) {
+            throw std::invalid_argument("compressed block is truncated");
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+} // namespace
+
+std::string LzCompress(std::string_view data) {
+    std::string out;
+    out.reserve(data.size() / 2 + 16);
+    PutVarint(out, data.size());
+    std::vector<int> table(size_t{ 1 } << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t position = 0;
+    while (position + MIN_MATCH <= data.size()) {
+        const uint32_t hash = Hash(Read32(data.data() + position));
+        const int candidate = table[hash];
+        table[hash] = static_cast<int>(position);
+        if (candidate < 0 || position - candidate > MAX_OFFSET || Read32(data.data() + candidate) != Read32(data.data() + position)) {
+            ++position;
+            continue;
+        }
+        size_t length = MIN_MATCH;
+        while (position + length < data.size() && data[candidate + length] == data[position + length]) {
+            ++length;
+        }
+        PutSequence(out, data.substr(anchor, position - anchor), position - candidate, length);
+        position += length;
+        anchor = position;
+    }
+    PutSequence(out, data.substr(anchor), 0, 0);
+    return out;
+}
+
+size_t LzCompressBound(size_t size) {
+    // varint размера, токен и байты продолжения длины литералов
+    return size + size / 255 + 16;
+}
+
+void LzDecompress(std::string_view compressed, std::string& out, size_t limit) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(compressed.data());
+    const uint8_t* const in_end = in + compressed.size();
+    const size_t size = GetVarint(in, in_end);
+    const size_t start = out.size();
+    // размер известен заранее, поэтому данные пишутся прямо в буфер без проверок емкости
+    out.resize(start + size);
+    char* const first = out.data() + start;
+    char* const last = first + size;
+    char* const stop = first + std::min(size, limit);
+    char* op = first;
+    while (op < stop) {
+        if (in == in_end) {
+            throw std::invalid_argument("compressed block is truncated");
+        }
+        const uint8_t token = *in++;
+        const size_t literal_length = GetLength(in, in_end, token >> 4);
+        if (static_cast<size_t>(in_end - in) < literal_length || static_cast<size_t>(last - op) < literal_length) {
+            throw std::invalid_argument("compressed block is truncated");
+        }
+        // короткие литералы копируются блоком фиксированного размера, если есть запас
+        if (literal_length <= WILD_COPY_SIZE && last - op >= static_cast<ptrdiff_t>(WILD_COPY_SIZE) && in_end - in >= static_cast<ptrdiff_t>(WILD_COPY_SIZE)) {
+            std::memcpy(op, in, WILD_COPY_SIZE);
+        }
+        else {
+            std::memcpy(op, in, literal_length);
+        }
+        op += literal_length;
+        in += literal_length;
+        if (in == in_end) {
+            break;
+        }
+        if (in_end - in < 2) {
+            throw std::invalid_argument("compressed block is truncated");
+        }
+        const size_t offset = in[0] | static_cast<size_t>(in[1]) << 8;
+        in += 2;
+        const size_t match_length = GetLength(in, in_end, token & 0x0F) + MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - first) || static_cast<size_t>(last - op) < match_length) {
+            throw std::invalid_argument("compressed block has a bad match");
+        }
+        const char* match = op - offset;
+        if (offset >= WILD_COPY_SIZE && match_length <= WILD_COPY_SIZE && last - op >= static_cast<ptrdiff_t>(WILD_COPY_SIZE)) {
+            std::memcpy(op, match, WILD_COPY_SIZE);
+            op += match_length;
+        }
+        else if (offset >= match_length) {
+            std::memcpy(op, match, match_length);
+            op += match_length;
+        }
+        else {
+            // совпадение перекрывает само себя, копирование побайтовое
+            for (char* const match_end = op + match_length; op < match_end; ++op, ++match) {
+                *op = *match;
+            }
+        }
+    }
+    if (op < stop) {
+        throw std::invalid_argument("compressed block is truncated");
+    }
+    out.resize(op - out.data());
+}
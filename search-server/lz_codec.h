@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// простой кодек семейства LZ77 (в духе LZ4) для блоков текста документов.
+// Данные - размер исходного текста (varint) и последовательности "литералы + совпадение": байт-токен (старшие 4 бита - длина
+// литералов, младшие - длина совпадения минус 4, значение 15 продолжается байтами до
+// первого не равного 255), литералы, смещение совпадения (2 байта). Последняя
+// последовательность состоит только из литералов
+std::string LzCompress(std::string_view data);
+
+// наибольший размер результата LzCompress для size байт (все байты - литералы)
+size_t LzCompressBound(size_t size);
+
+// распаковка в out (дописывается в конец); при поврежденных данных - std::invalid_argument.
+// Распаковка останавливается, как только получено не меньше limit байт: для чтения
+// документа из начала блока не нужно распаковывать весь блок
+void LzDecompress(std::string_view compressed, std::string& out, size_t limit = std::string::npos);
@@ -68,4 +68,6 @@ int main() {
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
+    Test("adaptive"s, search_server, queries, adaptive_policy);
+    cout << search_server.GetExecutionStats() << endl;
 }
\ No newline at end of file
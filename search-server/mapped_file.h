@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// файл, отображенный в память только для чтения. Сразу после отображения ядру сообщается,
+// что файл читается подряд (упреждающее чтение, вытеснение прочитанных страниц)
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+    // конец последовательного чтения: дальше к отображению обращаются выборочно
+    // (тексты документов для сниппетов), обычное упреждающее чтение ядра
+    void EndSequentialRead() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
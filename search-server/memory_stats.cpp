@@ -0,0 +1,36 @@
+#include "memory_stats.h"
+
+std::ostream& operator<<(std::ostream& out, const MemoryUsage& usage) {
+    out << "{ bytes = " << usage.bytes << ", elements = " << usage.element_count << ", overhead = " << usage.overhead_bytes << " }";
+    return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const IndexMemoryStats& stats) {
+    out << "inverted index: " << stats.inverted_index << std::endl
+        << "forward index: " << stats.forward_index << std::endl
+        << "documents: " << stats.documents << std::endl
+        << "document columns: " << stats.document_columns << std::endl
+        << "document sets: " << stats.document_sets << std::endl
+        << "dictionary: " << stats.dictionary << std::endl
+        << "document store: " << stats.document_store << std::endl
+        << "typo index: " << stats.typo_index << std::endl
+        << "terms = " << stats.term_count << ", postings = " << stats.posting_count
+        << ", postings per term = " << stats.average_postings_per_term
+        << ", bytes per posting = " << stats.bytes_per_posting
+        << ", total bytes = " << stats.total_bytes;
+    return out;
+}
+
+size_t GetAllocatedBlockSize(size_t size) {
+    // заголовок блока - 8 байт, блоки выровнены на 16 байт, минимальный блок - 32 байта
+    const size_t MIN_BLOCK_SIZE = 32;
+    const size_t block_size = (size + sizeof(size_t) + 15) / 16 * 16;
+    return block_size < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : block_size;
+}
+
+MemoryUsage GetTreeMemoryUsage(size_t n, size_t value_size) {
+    // узел дерева: цвет и три указателя, затем значение
+    const size_t NODE_HEADER_SIZE = 4 * sizeof(void*);
+    const size_t node_size = GetAllocatedBlockSize(NODE_HEADER_SIZE + value_size);
+    return { n * node_size, n, n * (node_size - value_size) };
+}
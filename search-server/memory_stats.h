@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+
+// оценка памяти одной структуры индекса
+struct MemoryUsage {
+    // общий объем вместе с накладными расходами
+    size_t bytes = 0;
+    size_t element_count = 0;
+    // служебные данные: узлы деревьев и заголовки блоков аллокатора
+    size_t overhead_bytes = 0;
+};
+
+// память, занятая индексом SearchServer
+struct IndexMemoryStats {
+    MemoryUsage inverted_index;     // слово -> документы (word_to_document_freqs_), элементы - постинги
+    MemoryUsage forward_index;      // документ -> слова (word_frequencies_), элементы - постинги
+    MemoryUsage documents;          // рейтинги и статусы документов, id документов
+    MemoryUsage document_columns;   // колонки рейтинга и статуса, внутренние номера документов, множества документов по статусам
+    MemoryUsage document_sets;      // битовые множества документов частых слов
+    MemoryUsage dictionary;         // строки слов, скопированные сервером в свой словарь
+    MemoryUsage document_store;     // сжатые тексты документов, элементы - документы
+    MemoryUsage typo_index;         // индекс триграмм словаря для поиска с опечатками, элементы - слова
+
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    double average_postings_per_term = 0.0;
+    // средний объем инвертированного и прямого индексов на один постинг
+    double bytes_per_posting = 0.0;
+    size_t total_bytes = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryUsage& usage);
+std::ostream& operator<<(std::ostream& out, const IndexMemoryStats& stats);
+
+// размер блока, который malloc выделит под size байт (64-битный glibc)
+size_t GetAllocatedBlockSize(size_t size);
+
+// оценка памяти n узлов красно-черного дерева (std::map, std::set) со значением размера value_size
+MemoryUsage GetTreeMemoryUsage(size_t n, size_t value_size);
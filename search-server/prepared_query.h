@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "cancellation.h"
+#include "document_bitmap.h"
+
+// запрос, заранее разобранный сервером: слова сопоставлены со словарём индекса,
+// стоп-слова и отсутствующие в индексе слова отброшены, префиксы ("serv*") и слова
+// с опечатками ("sevrer~") раскрыты в слова словаря, IDF посчитан.
+// Подходит для многократного поиска (разные фильтры, страницы) без повторного разбора.
+// Действителен только для подготовившего его сервера и до следующего изменения индекса
+// (AddDocument / RemoveDocument)
+struct PreparedQuery {
+    struct Term {
+        // слово из словаря сервера (не ссылается на текст исходного запроса)
+        std::string_view word;
+        double inverse_document_freq = 0.0;
+        // ключ - id документа, значение TF слова в документе
+        const std::map<int, double>* documents = nullptr;
+        // битовое множество документов слова, есть только у частых слов
+        const DocumentBitmap* document_set = nullptr;
+        // маска слов запроса, к которым относится слово (i-й бит - i-е плюс-слово);
+        // раскрытия префикса относятся к слову с префиксом
+        uint64_t clauses = 0;
+        // вес слова в релевантности, меньше 1 у слов, найденных с опечаткой;
+        // inverse_document_freq уже умножен на него
+        double weight = 1.0;
+    };
+
+    // в режиме min_should_match > 1 слов запроса может быть не больше
+    static const size_t MAX_CLAUSE_COUNT = 64;
+
+    PreparedQuery() = default;
+
+    explicit PreparedQuery(std::pmr::memory_resource* resource)
+        : plus_terms(resource), minus_terms(resource) {
+    }
+
+    std::pmr::vector<Term> plus_terms;
+    std::pmr::vector<Term> minus_terms;
+
+    // количество плюс-слов запроса, включая отсутствующие в индексе
+    size_t clause_count = 0;
+    // сколько плюс-слов должен содержать документ: 1 - любое (ИЛИ), clause_count - все (И)
+    size_t min_should_match = 1;
+
+    // сервер (идентификатор экземпляра) и ревизия его индекса, для которых подготовлен запрос
+    uint64_t index_id = 0;
+    uint64_t revision = 0;
+
+    // отмена поиска: проверяется между блоками постингов, отмененный поиск
+    // прерывается исключением QueryCancelledError
+    CancellationToken cancellation;
+
+    void RequireAllWords() {
+        min_should_match = clause_count;
+    }
+};
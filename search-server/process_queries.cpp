@@ -11,10 +11,38 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
     return result;
 }
 
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<PreparedQuery>& queries) {
+    std::vector<std::vector<Document>> result(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(), [&](const PreparedQuery& query) {
+        return search_server.FindTopDocuments(query);
+        });
+    return result;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(const AdaptivePolicy& policy, const SearchServer& search_server, const std::vector<std::string>& queries) {
+    std::vector<PreparedQuery> prepared_queries(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), prepared_queries.begin(), [&](const std::string& query) {
+        return search_server.PrepareQuery(query);
+        });
+    return ProcessQueries(policy, search_server, prepared_queries);
+}
+
+std::vector<std::vector<Document>> ProcessQueries(const AdaptivePolicy& policy, const SearchServer& search_server, const std::vector<PreparedQuery>& queries) {
+    return search_server.FindTopDocuments(policy, queries);
+}
+
 QueriesJoined<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
     QueriesJoined<Document> result;
     for (const auto& documents : ProcessQueries(search_server, queries)) {
         result.push_back(documents);
     }
     return result;
+}
+
+QueriesJoined<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<PreparedQuery>& queries) {
+    QueriesJoined<Document> result;
+    for (const auto& documents : ProcessQueries(search_server, queries)) {
+        result.push_back(documents);
+    }
+    return result;
 }
\ No newline at end of file
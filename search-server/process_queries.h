@@ -9,6 +9,13 @@
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
 
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<PreparedQuery>& queries);
+
+// выполнение пакетом или по одному запросу выбирает модель стоимости сервера
+std::vector<std::vector<Document>> ProcessQueries(const AdaptivePolicy& policy, const SearchServer& search_server, const std::vector<std::string>& queries);
+
+std::vector<std::vector<Document>> ProcessQueries(const AdaptivePolicy& policy, const SearchServer& search_server, const std::vector<PreparedQuery>& queries);
+
 template<typename Type>
 class QueriesJoined {
 public:
@@ -49,4 +56,6 @@ private:
     std::list<Type> data_;
 };
 
-QueriesJoined<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+QueriesJoined<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+QueriesJoined<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<PreparedQuery>& queries);
\ No newline at end of file
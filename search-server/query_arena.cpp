@@ -0,0 +1,50 @@
+#include <algorithm>
+
+#include "query_arena.h"
+
+QueryArena::Scope::Scope() : arena_(QueryArena::ForThisThread()) {
+    ++arena_.depth_;
+}
+
+QueryArena::Scope::~Scope() {
+    if (--arena_.depth_ == 0) {
+        arena_.Reset();
+    }
+}
+
+std::pmr::memory_resource* QueryArena::Scope::Resource() const {
+    return &*arena_.resource_;
+}
+
+QueryArena& QueryArena::ForThisThread() {
+    thread_local QueryArena arena;
+    return arena;
+}
+
+QueryArena::QueryArena() : buffer_(new std::byte[INITIAL_BUFFER_SIZE]), buffer_size_(INITIAL_BUFFER_SIZE) {
+    resource_.emplace(buffer_.get(), buffer_size_, &overflow_);
+}
+
+void QueryArena::Reset() {
+    // освобождаем все, что было взято сверх буфера
+    resource_.reset();
+    if (overflow_.allocated_bytes > 0 && buffer_size_ < MAX_BUFFER_SIZE) {
+        buffer_size_ = std::min(MAX_BUFFER_SIZE, 2 * (buffer_size_ + overflow_.allocated_bytes));
+        buffer_.reset(new std::byte[buffer_size_]);
+    }
+    overflow_.allocated_bytes = 0;
+    resource_.emplace(buffer_.get(), buffer_size_, &overflow_);
+}
+
+void* QueryArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    allocated_bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool QueryArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// арена для временных данных поискового запроса (разбор запроса, накопление релевантности).
+// У каждого потока своя арена, память сбрасывается целиком по завершении запроса.
+// Если запросу не хватило начального буфера, при сбросе буфер увеличивается,
+// так что в установившемся режиме обращений к глобальной куче нет
+class QueryArena {
+public:
+    // область действия запроса: при выходе из самой внешней области арена сбрасывается
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* Resource() const;
+
+    private:
+        QueryArena& arena_;
+    };
+
+    // арена текущего потока
+    static QueryArena& ForThisThread();
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+private:
+    QueryArena();
+
+    void Reset();
+
+    // ресурс, к которому арена обращается при переполнении буфера, подсчитывает выделенный объем
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t allocated_bytes = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    static const size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+    static const size_t MAX_BUFFER_SIZE = 64 * 1024 * 1024;
+
+    std::unique_ptr<std::byte[]> buffer_;
+    size_t buffer_size_ = 0;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    int depth_ = 0;
+};
@@ -0,0 +1,420 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <sstream>
+#include <system_error>
+
+#include "query_service.h"
+
+namespace {
+
+std::string_view NextToken(std::string_view& text) {
+    const size_t begin = std::min(text.size(), text.find_first_not_of(' '));
+    const size_t end = std::min(text.size(), text.find(' ', begin));
+    const std::string_view token = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    const size_t rest = std::min(text.size(), text.find_first_not_of(' '));
+    text.remove_prefix(rest);
+    return token;
+}
+
+int ParseInt(std::string_view text) {
+    int value = 0;
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        throw std::invalid_argument("expected a number");
+    }
+    return value;
+}
+
+std::vector<int> ParseRatings(std::string_view text) {
+    std::vector<int> ratings;
+    if (text == "-") {
+        return ratings;
+    }
+    while (!text.empty()) {
+        const size_t comma = std::min(text.size(), text.find(','));
+        ratings.push_back(ParseInt(text.substr(0, comma)));
+        text.remove_prefix(std::min(text.size(), comma + 1));
+    }
+    return ratings;
+}
+
+bool IsMutation(std::string_view line) {
+    const std::string_view command = NextToken(line);
+    return command == "ADD" || command == "REMOVE";
+}
+
+void ThrowSystemError(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+QueryService::QueryService(SearchServer& search_server, QueryServiceConfig config)
+    : search_server_(search_server), config_(config)
+{
+    if (config_.event_loop_count == 0) {
+        throw std::invalid_argument("query service needs at least one event loop");
+    }
+}
+
+QueryService::~QueryService()
+{
+    Stop();
+}
+
+void QueryService::Start()
+{
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listen_fd_ < 0) {
+        ThrowSystemError("socket");
+    }
+    const int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(config_.port);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd_, SOMAXCONN) < 0) {
+        ThrowSystemError("bind");
+    }
+    socklen_t length = sizeof(address);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+
+    workers_ = std::make_unique<ThreadPool>(config_.worker_count);
+    for (size_t i = 0; i < config_.event_loop_count; ++i) {
+        auto loop = std::make_unique<EventLoop>();
+        loop->epoll_fd = epoll_create1(0);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK);
+        if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+            ThrowSystemError("epoll");
+        }
+        // соединения принимает тот поток событий, который проснулся первым
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.fd = listen_fd_;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, listen_fd_, &event);
+        event.events = EPOLLIN;
+        event.data.fd = loop->wake_fd;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &event);
+        loops_.push_back(std::move(loop));
+    }
+    for (auto& loop : loops_) {
+        loop->thread = std::thread([this, &loop = *loop] { RunLoop(loop); });
+    }
+}
+
+void QueryService::Stop()
+{
+    if (stopping_.exchange(true)) {
+        return;
+    }
+    for (auto& loop : loops_) {
+        const uint64_t one = 1;
+        write(loop->wake_fd, &one, sizeof(one));
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+    // задачи пула обращаются к потокам событий, поэтому пул останавливается раньше, чем они удаляются
+    workers_.reset();
+    for (auto& loop : loops_) {
+        for (const auto& [fd, _] : loop->connections) {
+            close(fd);
+        }
+        close(loop->epoll_fd);
+        close(loop->wake_fd);
+    }
+    loops_.clear();
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+uint16_t QueryService::GetPort() const
+{
+    return port_;
+}
+
+QueryServiceStats QueryService::GetStats() const
+{
+    return { request_count_.load(), total_latency_us_.load(), max_latency_us_.load() };
+}
+
+std::string QueryService::ExecuteRequest(SearchServer& search_server, std::shared_mutex& search_server_mutex, std::string_view request)
+{
+    std::ostringstream response;
+    try {
+        const std::string_view command = NextToken(request);
+        if (command == "FIND") {
+            std::vector<Document> documents;
+            {
+                std::shared_lock lock(search_server_mutex);
+                documents = search_server.FindTopDocuments(request);
+            }
+            response << "OK " << documents.size();
+            for (const Document& document : documents) {
+                response << ' ' << document.id << ' ' << document.relevance << ' ' << document.rating;
+            }
+        }
+        else if (command == "MATCH") {
+            const int document_id = ParseInt(NextToken(request));
+            std::shared_lock lock(search_server_mutex);
+            const auto [words, status] = search_server.MatchDocument(request, document_id);
+            response << "OK " << GetStatusName(status) << ' ' << words.size();
+            for (const std::string_view word : words) {
+                response << ' ' << word;
+            }
+        }
+        else if (command == "ADD") {
+            const int document_id = ParseInt(NextToken(request));
+            const DocumentStatus status = ParseDocumentStatus(NextToken(request));
+            const std::vector<int> ratings = ParseRatings(NextToken(request));
+            std::unique_lock lock(search_server_mutex);
+            search_server.AddDocument(document_id, request, status, ratings);
+            response << "OK";
+        }
+        else if (command == "REMOVE") {
+            const int document_id = ParseInt(NextToken(request));
+            std::unique_lock lock(search_server_mutex);
+            search_server.RemoveDocument(document_id);
+            response << "OK";
+        }
+        else {
+            response << "ERROR unknown command";
+        }
+    }
+    catch (const std::exception& e) {
+        response.str({});
+        response << "ERROR " << e.what();
+    }
+    // ответ всегда занимает одну строку
+    std::string result = response.str();
+    std::replace(result.begin(), result.end(), '\n', ' ');
+    return result;
+}
+
+void QueryService::RunLoop(EventLoop& loop)
+{
+    const int MAX_EVENTS = 64;
+    const int TIMEOUT_MS = 100;
+    epoll_event events[MAX_EVENTS];
+    while (!stopping_) {
+        const int count = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, TIMEOUT_MS);
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                AcceptConnections(loop);
+                continue;
+            }
+            if (fd == loop.wake_fd) {
+                uint64_t value;
+                read(loop.wake_fd, &value, sizeof(value));
+                ProcessCompletions(loop);
+                continue;
+            }
+            const auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) {
+                continue;
+            }
+            Connection& connection = *it->second;
+            bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if (alive && (events[i].events & EPOLLIN)) {
+                alive = ReadRequests(loop, connection);
+            }
+            if (alive && (events[i].events & EPOLLOUT)) {
+                alive = Flush(loop, connection);
+            }
+            if (!alive) {
+                CloseConnection(loop, fd);
+            }
+        }
+    }
+}
+
+void QueryService::AcceptConnections(EventLoop& loop)
+{
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            return;
+        }
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->id = next_connection_id_++;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        loop.connections[fd] = std::move(connection);
+    }
+}
+
+bool QueryService::ReadRequests(EventLoop& loop, Connection& connection)
+{
+    char buffer[64 * 1024];
+    while (true) {
+        const ssize_t size = read(connection.fd, buffer, sizeof(buffer));
+        if (size == 0) {
+            connection.input_closed = true;
+            break;
+        }
+        if (size < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        connection.input.append(buffer, size);
+    }
+
+    const Clock::time_point now = Clock::now();
+    size_t begin = 0;
+    for (size_t end = connection.input.find('\n'); end != std::string::npos; end = connection.input.find('\n', begin)) {
+        std::string line = connection.input.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const bool is_mutation = IsMutation(line);
+        connection.waiting.push_back({ connection.next_sequence++, std::move(line), is_mutation, now });
+        begin = end + 1;
+    }
+    connection.input.erase(0, begin);
+    if (connection.input.size() > MAX_LINE_LENGTH) {
+        return false;
+    }
+    if (connection.input_closed) {
+        // незавершенная строка после закрытия ввода уже не станет командой
+        connection.input.clear();
+    }
+    Dispatch(loop, connection);
+    return Flush(loop, connection);
+}
+
+void QueryService::Dispatch(EventLoop& loop, Connection& connection)
+{
+    while (!connection.waiting.empty() && !connection.mutation_in_flight) {
+        Request& request = connection.waiting.front();
+        if (request.is_mutation) {
+            if (connection.in_flight > 0) {
+                return;
+            }
+            connection.mutation_in_flight = true;
+        }
+        ++connection.in_flight;
+        workers_->Submit([this, &loop, fd = connection.fd, connection_id = connection.id, request = std::move(request)] {
+            std::string response = ExecuteRequest(search_server_, search_server_mutex_, request.line);
+            RecordLatency(request.received);
+            {
+                std::lock_guard lock(loop.mutex);
+                loop.completions.push_back({ fd, connection_id, request.sequence, request.is_mutation, std::move(response) });
+            }
+            const uint64_t one = 1;
+            write(loop.wake_fd, &one, sizeof(one));
+            });
+        connection.waiting.pop_front();
+    }
+}
+
+void QueryService::ProcessCompletions(EventLoop& loop)
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard lock(loop.mutex);
+        completions.swap(loop.completions);
+    }
+    std::vector<int> touched;
+    for (Completion& completion : completions) {
+        const auto it = loop.connections.find(completion.fd);
+        // соединение могло закрыться, а его дескриптор - достаться новому соединению
+        if (it == loop.connections.end() || it->second->id != completion.connection_id) {
+            continue;
+        }
+        Connection& connection = *it->second;
+        --connection.in_flight;
+        if (completion.is_mutation) {
+            connection.mutation_in_flight = false;
+        }
+        connection.ready.emplace(completion.sequence, std::move(completion.response));
+        while (!connection.ready.empty() && connection.ready.begin()->first == connection.next_to_write) {
+            connection.output += connection.ready.begin()->second;
+            connection.output += '\n';
+            connection.ready.erase(connection.ready.begin());
+            ++connection.next_to_write;
+        }
+        touched.push_back(completion.fd);
+    }
+    for (const int fd : touched) {
+        const auto it = loop.connections.find(fd);
+        if (it == loop.connections.end()) {
+            continue;
+        }
+        Dispatch(loop, *it->second);
+        if (!Flush(loop, *it->second)) {
+            CloseConnection(loop, fd);
+        }
+    }
+}
+
+bool QueryService::Flush(EventLoop& loop, Connection& connection)
+{
+    while (!connection.output.empty()) {
+        const ssize_t size = send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+        if (size < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        connection.output.erase(0, size);
+    }
+    // ждем возможности записи, только пока есть неотправленные данные,
+    // а чтения - пока клиент не закрыл ввод (иначе конец потока будет сообщаться бесконечно)
+    const bool need_read_watch = !connection.input_closed;
+    const bool need_write_watch = !connection.output.empty();
+    if (need_read_watch != connection.readable_watch || need_write_watch != connection.writable_watch) {
+        uint32_t events = 0;
+        if (need_read_watch) {
+            events |= EPOLLIN | EPOLLRDHUP;
+        }
+        if (need_write_watch) {
+            events |= EPOLLOUT;
+        }
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = connection.fd;
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.readable_watch = need_read_watch;
+        connection.writable_watch = need_write_watch;
+    }
+    return !connection.input_closed || connection.in_flight > 0 || !connection.waiting.empty() || !connection.output.empty();
+}
+
+void QueryService::CloseConnection(EventLoop& loop, int fd)
+{
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    loop.connections.erase(fd);
+}
+
+void QueryService::RecordLatency(Clock::time_point received)
+{
+    const uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - received).count();
+    ++request_count_;
+    total_latency_us_ += latency;
+    uint64_t max_latency = max_latency_us_.load();
+    while (latency > max_latency && !max_latency_us_.compare_exchange_weak(max_latency, latency)) {
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "search_server.h"
+#include "thread_pool.h"
+
+// сетевой сервис поиска (Linux, epoll). Протокол строковый, одна команда на строку:
+//   FIND <query>                      -> OK <count> [<id> <relevance> <rating>]...
+//   MATCH <id> <query>                -> OK <status> <count> [<word>]...
+//   ADD <id> <status> <ratings> <text> -> OK      (ratings через запятую или "-")
+//   REMOVE <id>                       -> OK
+// при ошибке отвечает ERROR <message>. Клиент может отправлять команды, не дожидаясь
+// ответов (конвейер): ответы приходят в порядке команд. Соединения обслуживают
+// несколько потоков событий, поиск выполняется в пуле рабочих потоков
+struct QueryServiceConfig {
+    // 0 - выбрать свободный порт
+    uint16_t port = 0;
+    size_t event_loop_count = 2;
+    size_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// статистика сервиса: задержка считается от получения команды до готовности ответа
+struct QueryServiceStats {
+    uint64_t request_count = 0;
+    uint64_t total_latency_us = 0;
+    uint64_t max_latency_us = 0;
+};
+
+class QueryService {
+public:
+    QueryService(SearchServer& search_server, QueryServiceConfig config = {});
+
+    ~QueryService();
+
+    QueryService(const QueryService&) = delete;
+    QueryService& operator=(const QueryService&) = delete;
+
+    void Start();
+    void Stop();
+
+    uint16_t GetPort() const;
+
+    QueryServiceStats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        uint64_t sequence;
+        std::string line;
+        bool is_mutation;
+        Clock::time_point received;
+    };
+
+    struct Connection {
+        int fd;
+        uint64_t id;
+        std::string input;
+        std::string output;
+        uint64_t next_sequence = 0;
+        uint64_t next_to_write = 0;
+        // готовые ответы, которые ждут ответов на более ранние команды
+        std::map<uint64_t, std::string> ready;
+        // команды, еще не отданные в пул: изменение индекса ждет завершения всех
+        // предыдущих команд соединения, а последующие команды - завершения изменения
+        std::deque<Request> waiting;
+        size_t in_flight = 0;
+        bool mutation_in_flight = false;
+        // клиент закрыл свою сторону: новых команд не будет, соединение закрывается
+        // после отправки ответов на все уже полученные команды
+        bool input_closed = false;
+        bool readable_watch = true;
+        bool writable_watch = false;
+    };
+
+    struct Completion {
+        int fd;
+        uint64_t connection_id;
+        uint64_t sequence;
+        bool is_mutation;
+        std::string response;
+    };
+
+    struct EventLoop {
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        std::thread thread;
+        std::mutex mutex;
+        std::vector<Completion> completions;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    };
+
+    static const size_t MAX_LINE_LENGTH = 1 << 20;
+
+    SearchServer& search_server_;
+    std::shared_mutex search_server_mutex_;
+    QueryServiceConfig config_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_ = false;
+    std::atomic<uint64_t> next_connection_id_ = 0;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::unique_ptr<ThreadPool> workers_;
+
+    std::atomic<uint64_t> request_count_ = 0;
+    std::atomic<uint64_t> total_latency_us_ = 0;
+    std::atomic<uint64_t> max_latency_us_ = 0;
+
+    // выполнение одной команды протокола
+    static std::string ExecuteRequest(SearchServer& search_server, std::shared_mutex& search_server_mutex, std::string_view request);
+
+    void RunLoop(EventLoop& loop);
+    void AcceptConnections(EventLoop& loop);
+    // возвращает false, если соединение нужно закрыть
+    bool ReadRequests(EventLoop& loop, Connection& connection);
+    void Dispatch(EventLoop& loop, Connection& connection);
+    void ProcessCompletions(EventLoop& loop);
+    // возвращает false, если соединение нужно закрыть (в том числе когда ввод закрыт и все ответы отправлены)
+    bool Flush(EventLoop& loop, Connection& connection);
+    void CloseConnection(EventLoop& loop, int fd);
+    void RecordLatency(Clock::time_point received);
+};
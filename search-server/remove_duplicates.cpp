@@ -8,32 +8,22 @@
 
 //сложность RemoveDuplicates должна быть O(wN(log⁡N+log⁡W))O(wN(logN+logW)), где ww — максимальное количество слов в документе.
 void RemoveDuplicates(SearchServer& search_server) {
-    std::map<int, std::map<std::string_view, double>> all_docs;
+    // слова документа уже отсортированы, поэтому набор слов сравнивается как вектор
+    std::set<std::vector<std::string_view>> word_sets;
     std::set<int> id_docs_for_delete;
     for (const int doc_id : search_server) {
-        const auto tmp = search_server.GetWordFrequencies(doc_id);
-        all_docs[doc_id] = tmp;
-        if (all_docs.size() > 1) {
-            auto It = all_docs.begin();
-            for (;It != all_docs.end();++It) {
-                if (tmp.size() != (*It).second.size() || (*It).first == doc_id) {
-                    continue;
-                }
-                bool match = false;
-                for (const auto& [word, tf] : (*It).second) {
-                    match = tmp.count(word);
-                    if (!match) {
-                        break;
-                    }
-                }
-                if (match) {
-                    id_docs_for_delete.insert(doc_id);
-                }
-            }
+        const WordFrequenciesView words = search_server.GetWordFrequencies(doc_id);
+        std::vector<std::string_view> word_set;
+        word_set.reserve(words.size());
+        for (const auto& [word, tf] : words) {
+            word_set.push_back(word);
+        }
+        if (!word_set.empty() && !word_sets.insert(std::move(word_set)).second) {
+            id_docs_for_delete.insert(doc_id);
         }
     }
     for (const auto& id : id_docs_for_delete) {
         std::cout << "Found duplicate document id " << id << std::endl;
         search_server.RemoveDocument(id);
     }
-}
\ No newline at end of file
+}
@@ -3,11 +3,18 @@
 RequestQueue::RequestQueue(const SearchServer& search_server):search_server_(search_server) {}
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return RequestQueue::AddFindRequest(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+    return RequestQueue::AddFindRequest(raw_query, DocumentFilter{ status });
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
     return RequestQueue::AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(const PreparedQuery& query, DocumentStatus status) {
+    // статус проверяется фильтром при обходе индекса
+    return RequestQueue::AddFindRequest(query, DocumentFilter{ status });
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(const PreparedQuery& query) {
+    return RequestQueue::AddFindRequest(query, DocumentStatus::ACTUAL);
 }
\ No newline at end of file
@@ -16,6 +16,13 @@ public:
 
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const PreparedQuery& query, DocumentPredicate document_predicate);
+
+    std::vector<Document> AddFindRequest(const PreparedQuery& query, DocumentStatus status);
+
+    std::vector<Document> AddFindRequest(const PreparedQuery& query);
+
     int GetNoResultRequests() const {
         return empty_requests_;
     }
@@ -34,11 +41,16 @@ private:
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    return AddFindRequest(search_server_.PrepareQuery(raw_query), document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> RequestQueue::AddFindRequest(const PreparedQuery& query, DocumentPredicate document_predicate) {
     if (time_count_++ > min_in_day_) {
         requests_.pop_front();
         --empty_requests_;
     }
-    std::vector<Document> find_top_document = search_server_.FindTopDocuments(raw_query, document_predicate);
+    std::vector<Document> find_top_document = search_server_.FindTopDocuments(query, document_predicate);
     QueryResult tmp;
     tmp.request_success = !find_top_document.empty();
     tmp.time_request = time_count_;
@@ -2,6 +2,7 @@
 #include "log_duration.h"
 
 #include <functional>
+#include <limits>
 
 std::set<int>::iterator SearchServer::begin() const
 {
@@ -13,6 +14,25 @@ std::set<int>::iterator SearchServer::end() const
 }
 
 void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    AddDocument(document_id, document, status, ratings, true);
+    if (write_ahead_log_) {
+        write_ahead_log_->AppendAdd(document_id, document, status, ratings);
+    }
+}
+
+void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings, const std::shared_ptr<const void>& storage)
+{
+    if (storages_.empty() || storages_.back() != storage) {
+        storages_.push_back(storage);
+    }
+    AddDocument(document_id, document, status, ratings, false);
+    if (write_ahead_log_) {
+        write_ahead_log_->AppendAdd(document_id, document, status, ratings);
+    }
+}
+
+void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings, bool copy_words)
 {
     // если id меньше нуля или id уже есть среди добавленных документов или переданная
     // строка содрежит спецсимволы, вернуть false
@@ -20,16 +40,227 @@ void SearchServer::AddDocument(int document_id, const std::string_view document,
         throw std::invalid_argument("ID cannot be negative");
     if (documents_.count(document_id))
         throw std::invalid_argument("this ID already exists");
+    QueryArena::Scope arena;
+    const std::pmr::vector<std::string_view> words = SplitIntoIndexWords(document, arena.Resource());
+    if (memory_budget_ > 0) {
+        CheckMemoryBudget(document_id, document, status, words, copy_words, false, arena.Resource());
+    }
     SearchServer::documents_id_.insert(document_id);
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
     const double inv_word_count = 1.0 / words.size();
+    std::pmr::vector<WordFrequency> document_words(arena.Resource());
+    document_words.reserve(words.size());
     for (const std::string_view& word : words)
     {
-        const auto [new_word, inserted] = all_words_.insert(static_cast<std::string>(word));
-        word_to_document_freqs_[*new_word][document_id] += inv_word_count;
-        word_frequencies_[document_id][*new_word] += inv_word_count;
+        // слово, уже известное индексу, не копируется повторно
+        const auto postings = AddDictionaryWord(word, copy_words);
+        postings->second[document_id] += inv_word_count;
+        document_words.push_back({ postings->first, inv_word_count });
+        AddToDocumentSet(*postings, document_id);
     }
+    MergeWordFrequencies(document_words);
+    const uint32_t slot = AcquireDocumentSlot(document_id);
+    word_frequencies_.Add(slot, document_words.begin(), document_words.end());
+    posting_count_ += document_words.size();
     documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    rating_column_[slot] = documents_.at(document_id).rating;
+    status_column_[slot] = status;
+    status_documents_[static_cast<int>(status)].Add(document_id);
+    if (document_store_) {
+        document_store_->Add(slot, document);
+    }
+    ++revision_;
+}
+
+void SearchServer::UpdateDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    if (!documents_.count(document_id)) {
+        throw std::out_of_range("id not exists");
+    }
+    QueryArena::Scope arena;
+    const std::pmr::vector<std::string_view> words = SplitIntoIndexWords(document, arena.Resource());
+    if (memory_budget_ > 0) {
+        CheckMemoryBudget(document_id, document, status, words, true, true, arena.Resource());
+    }
+    const double inv_word_count = 1.0 / words.size();
+    std::pmr::vector<WordFrequency> document_words(arena.Resource());
+    document_words.reserve(words.size());
+    for (const std::string_view& word : words) {
+        document_words.push_back({ word, inv_word_count });
+    }
+    MergeWordFrequencies(document_words);
+
+    // слияние отсортированных старого и нового списков слов документа
+    const uint32_t slot = GetDocumentSlot(document_id);
+    const WordFrequenciesView old_words = word_frequencies_.Get(slot);
+    const WordFrequency* old_word = old_words.begin();
+    for (WordFrequency& new_word : document_words) {
+        for (; old_word != old_words.end() && old_word->word < new_word.word; ++old_word) {
+            RemovePosting(old_word->word, document_id);
+        }
+        if (old_word != old_words.end() && old_word->word == new_word.word) {
+            if (old_word->frequency != new_word.frequency) {
+                word_to_document_freqs_.find(old_word->word)->second.at(document_id) = new_word.frequency;
+            }
+            new_word.word = old_word->word;
+            ++old_word;
+            continue;
+        }
+        const auto postings = AddDictionaryWord(new_word.word, true);
+        postings->second[document_id] = new_word.frequency;
+        AddToDocumentSet(*postings, document_id);
+        new_word.word = postings->first;
+    }
+    for (; old_word != old_words.end(); ++old_word) {
+        RemovePosting(old_word->word, document_id);
+    }
+    posting_count_ -= word_frequencies_.Remove(slot);
+    word_frequencies_.Add(slot, document_words.begin(), document_words.end());
+    posting_count_ += document_words.size();
+
+    SetDocumentAttributes(document_id, status, ratings);
+    if (document_store_) {
+        document_store_->Add(slot, document);
+    }
+    ++revision_;
+    if (write_ahead_log_) {
+        write_ahead_log_->AppendUpdate(document_id, document, status, ratings);
+    }
+}
+
+void SearchServer::UpdateDocument(int document_id, DocumentStatus status, const std::vector<int>& ratings)
+{
+    if (!documents_.count(document_id)) {
+        throw std::out_of_range("id not exists");
+    }
+    SetDocumentAttributes(document_id, status, ratings);
+    if (write_ahead_log_) {
+        write_ahead_log_->AppendUpdateAttributes(document_id, status, ratings);
+    }
+}
+
+std::pmr::vector<std::string_view> SearchServer::SplitIntoIndexWords(const std::string_view document, std::pmr::memory_resource* resource) const
+{
+    std::pmr::vector<std::string_view> words = SplitIntoWords(document, resource);
+    words.erase(std::remove_if(words.begin(), words.end(), [&](const std::string_view word) { return IsStopWord(word); }), words.end());
+    return words;
+}
+
+void SearchServer::MergeWordFrequencies(std::pmr::vector<WordFrequency>& document_words)
+{
+    std::sort(document_words.begin(), document_words.end(), [](const WordFrequency& lhs, const WordFrequency& rhs) {
+        return lhs.word < rhs.word;
+        });
+    size_t unique_count = 0;
+    for (size_t i = 0; i < document_words.size(); ++i) {
+        if (unique_count > 0 && document_words[unique_count - 1].word == document_words[i].word) {
+            document_words[unique_count - 1].frequency += document_words[i].frequency;
+        }
+        else {
+            document_words[unique_count++] = document_words[i];
+        }
+    }
+    document_words.resize(unique_count);
+}
+
+std::map<std::string_view, std::map<int, double>>::iterator SearchServer::AddDictionaryWord(const std::string_view word, bool copy_words)
+{
+    auto postings = word_to_document_freqs_.find(word);
+    if (postings != word_to_document_freqs_.end()) {
+        return postings;
+    }
+    std::string_view new_word = word;
+    if (copy_words) {
+        const auto [stored_word, inserted] = words_.Insert(word);
+        if (inserted) {
+            ++dictionary_word_count_;
+            dictionary_bytes_ += GetDictionaryWordBytes(word);
+        }
+        new_word = stored_word;
+    }
+    postings = word_to_document_freqs_.emplace(new_word, std::map<int, double>{}).first;
+    if (typo_index_) {
+        typo_index_->Add(postings->first);
+    }
+    return postings;
+}
+
+void SearchServer::AddToDocumentSet(const std::pair<const std::string_view, std::map<int, double>>& postings, int document_id)
+{
+    if (postings.second.size() < DOCUMENT_SET_MIN_FREQ) {
+        const auto document_set = word_to_document_set_.find(postings.first);
+        if (document_set != word_to_document_set_.end()) {
+            document_set->second.Add(document_id);
+        }
+        return;
+    }
+    const auto [document_set, inserted] = word_to_document_set_.try_emplace(postings.first);
+    if (inserted) {
+        for (const auto [id, _] : postings.second) {
+            document_set->second.Add(id);
+        }
+    }
+    else {
+        document_set->second.Add(document_id);
+    }
+}
+
+void SearchServer::RemovePosting(const std::string_view word, int document_id)
+{
+    word_to_document_freqs_.find(word)->second.erase(document_id);
+    RemoveFromDocumentSet(word, document_id);
+}
+
+void SearchServer::RemoveFromDocumentSet(const std::string_view word, int document_id)
+{
+    const auto document_set = word_to_document_set_.find(word);
+    if (document_set == word_to_document_set_.end()) {
+        return;
+    }
+    document_set->second.Remove(document_id);
+    if (document_set->second.Size() < DOCUMENT_SET_DROP_FREQ) {
+        word_to_document_set_.erase(document_set);
+    }
+}
+
+void SearchServer::SetDocumentAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings)
+{
+    DocumentData& data = documents_.at(document_id);
+    if (data.status != status) {
+        status_documents_[static_cast<int>(data.status)].Remove(document_id);
+        status_documents_[static_cast<int>(status)].Add(document_id);
+    }
+    data = { ComputeAverageRating(ratings), status };
+    const uint32_t slot = GetDocumentSlot(document_id);
+    rating_column_[slot] = data.rating;
+    status_column_[slot] = status;
+}
+
+uint32_t SearchServer::GetDocumentSlot(int document_id) const
+{
+    return document_slots_.find(document_id)->second;
+}
+
+uint32_t SearchServer::AcquireDocumentSlot(int document_id)
+{
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else {
+        slot = static_cast<uint32_t>(rating_column_.size());
+        rating_column_.push_back(0);
+        status_column_.push_back(DocumentStatus::ACTUAL);
+    }
+    document_slots_.emplace(document_id, slot);
+    return slot;
+}
+
+void SearchServer::ReleaseDocumentSlot(int document_id)
+{
+    const auto it = document_slots_.find(document_id);
+    free_slots_.push_back(it->second);
+    document_slots_.erase(it);
 }
 
 void SearchServer::AddDocument(SearchServer& search_server, int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
@@ -42,12 +273,23 @@ void SearchServer::RemoveDocument(int document_id)
 {
     if (documents_id_.count(document_id))
     {
+        status_documents_[static_cast<int>(documents_.at(document_id).status)].Remove(document_id);
         documents_id_.erase(document_id);
         documents_.erase(document_id);
-        word_frequencies_.erase(document_id);
-        for (auto& [word, data] : word_to_document_freqs_)
+        RemoveFromDocumentSets(document_id);
+        const uint32_t slot = GetDocumentSlot(document_id);
+        for (const auto& [word, _] : word_frequencies_.Get(slot))
         {
-            data.erase(document_id);
+            word_to_document_freqs_.at(word).erase(document_id);
+        }
+        posting_count_ -= word_frequencies_.Remove(slot);
+        ReleaseDocumentSlot(document_id);
+        if (document_store_) {
+            document_store_->Remove(slot);
+        }
+        ++revision_;
+        if (write_ahead_log_) {
+            write_ahead_log_->AppendRemove(document_id);
         }
     }
 }
@@ -61,14 +303,44 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy& par, in
 {
     if (documents_id_.find(document_id) != documents_id_.end())
     {
+        status_documents_[static_cast<int>(documents_.at(document_id).status)].Remove(document_id);
         documents_.erase(document_id);
         documents_id_.erase(document_id);
-        std::vector<std::string_view> tmp(word_frequencies_.at(document_id).size());
-        std::transform(par, word_frequencies_.at(document_id).begin(), word_frequencies_.at(document_id).end(), tmp.begin(), [](const auto& data)
-            { return data.first; });
-        std::for_each(par, tmp.begin(), tmp.end(), [&](const auto& word)
-            { SearchServer::word_to_document_freqs_.at(word).erase(document_id); });
-        word_frequencies_.erase(document_id);
+        // слова документа различны, поэтому каждый поток меняет свой список постингов
+        const uint32_t slot = GetDocumentSlot(document_id);
+        const WordFrequenciesView words = word_frequencies_.Get(slot);
+        std::for_each(par, words.begin(), words.end(), [&](const WordFrequency& entry)
+            { SearchServer::word_to_document_freqs_.at(entry.word).erase(document_id); });
+        RemoveFromDocumentSets(document_id);
+        posting_count_ -= word_frequencies_.Remove(slot);
+        ReleaseDocumentSlot(document_id);
+        if (document_store_) {
+            document_store_->Remove(slot);
+        }
+        ++revision_;
+        if (write_ahead_log_) {
+            write_ahead_log_->AppendRemove(document_id);
+        }
+    }
+}
+
+void SearchServer::RemoveDocument(const AdaptivePolicy&, int document_id)
+{
+    const uint64_t work = documents_.count(document_id) ? word_frequencies_.Get(GetDocumentSlot(document_id)).size() : 0;
+    RunAdaptive(ExecutionOperation::REMOVE_DOCUMENT, work, [&](ExecutionMode mode) {
+        if (mode == ExecutionMode::PARALLEL) {
+            RemoveDocument(std::execution::par, document_id);
+        }
+        else {
+            RemoveDocument(document_id);
+        }
+        });
+}
+
+void SearchServer::RemoveFromDocumentSets(int document_id)
+{
+    for (const auto& [word, _] : word_frequencies_.Get(GetDocumentSlot(document_id))) {
+        RemoveFromDocumentSet(word, document_id);
     }
 }
 
@@ -79,31 +351,153 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy& par, in
 //     return word_frequencies_.count(document_id) ? word_frequencies_.at(document_id) : empty_map_;
 // }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+WordFrequenciesView SearchServer::GetWordFrequencies(int document_id) const
+{
+    return documents_.count(document_id) ? word_frequencies_.Get(GetDocumentSlot(document_id)) : WordFrequenciesView{};
+}
+
+PreparedQuery SearchServer::PrepareQuery(const std::string_view raw_query) const
 {
-    static std::map<std::string_view, double> empty_map_;
-    return word_frequencies_.count(document_id) ? word_frequencies_.at(document_id) : empty_map_;
+    return PrepareQuery(raw_query, std::pmr::get_default_resource());
+}
+
+PreparedQuery SearchServer::PrepareQuery(const std::execution::parallel_policy& par, const std::string_view raw_query) const
+{
+    return PrepareQuery(par, raw_query, std::pmr::get_default_resource());
+}
+
+PreparedQuery SearchServer::PrepareQuery(const std::string_view raw_query, std::pmr::memory_resource* resource) const
+{
+    QueryArena::Scope arena;
+    return ResolveQuery(ParseQuery(raw_query, arena.Resource()), resource);
+}
+
+PreparedQuery SearchServer::PrepareQuery(const std::execution::parallel_policy& par, const std::string_view raw_query, std::pmr::memory_resource* resource) const
+{
+    QueryArena::Scope arena;
+    return ResolveQuery(ParseQuery(par, raw_query, arena.Resource()), resource);
+}
+
+PreparedQuery SearchServer::PrepareQuery(const std::string_view raw_query, const QueryExpansions& expansions) const
+{
+    QueryArena::Scope arena;
+    return ResolveQuery(ParseQuery(raw_query, arena.Resource()), std::pmr::get_default_resource(), &expansions);
+}
+
+SearchServer::QueryExpansions SearchServer::ExpandQuery(const std::string_view raw_query, const std::vector<SearchServer>& servers)
+{
+    QueryExpansions expansions;
+    if (servers.empty()) {
+        return expansions;
+    }
+    const SearchServer& first = servers.front();
+    QueryArena::Scope arena;
+    const Query query = first.ParseQuery(raw_query, arena.Resource());
+    auto expand_prefix = [&](const std::string_view word, size_t max_expansion, QueryExpansions::WordExpansions& result) {
+        // у каждого сервера берутся первые max_expansion слов, среди них - первые в объединении
+        std::vector<std::string_view> words;
+        for (const SearchServer& server : servers) {
+            server.ExpandPrefix(word.substr(0, word.size() - 1), max_expansion, [&](const auto& entry) {
+                words.push_back(entry.first);
+                });
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        if (words.size() > max_expansion) {
+            words.resize(max_expansion);
+        }
+        auto& expanded = result[std::string(word)];
+        for (const std::string_view expanded_word : words) {
+            expanded.emplace_back(expanded_word, 1.0);
+        }
+    };
+    for (const std::string_view word : query.minus_words) {
+        if (word.size() > 1 && word.back() == '*') {
+            expand_prefix(word, std::numeric_limits<size_t>::max(), expansions.minus_words);
+        }
+    }
+    for (const std::string_view word : query.plus_words) {
+        if (word.size() > 1 && word.back() == '*') {
+            expand_prefix(word, MAX_PREFIX_EXPANSION, expansions.plus_words);
+            continue;
+        }
+        if (!first.typo_index_) {
+            continue;
+        }
+        const bool is_typo_query = word.size() > 1 && word.back() == '~';
+        const std::string_view exact_word = is_typo_query ? word.substr(0, word.size() - 1) : word;
+        const bool found = std::any_of(servers.begin(), servers.end(), [&](const SearchServer& server) {
+            const auto it = server.word_to_document_freqs_.find(exact_word);
+            return it != server.word_to_document_freqs_.end() && !it->second.empty();
+            });
+        if (!is_typo_query && (found || !first.typo_config_.correct_missing_words)) {
+            continue;
+        }
+        const int max_distance = first.GetMaxTypoDistance(exact_word);
+        if (max_distance == 0) {
+            continue;
+        }
+        // расстояние до похожего слова и его документная частота во всей коллекции
+        std::map<std::string_view, std::pair<int, size_t>> similar_words;
+        for (const SearchServer& server : servers) {
+            if (!server.typo_index_) {
+                continue;
+            }
+            for (const SimilarWord& similar : server.typo_index_->FindSimilar(exact_word, max_distance)) {
+                const size_t document_count = server.word_to_document_freqs_.find(similar.word)->second.size();
+                if (document_count > 0) {
+                    auto& [distance, total_count] = similar_words[similar.word];
+                    distance = similar.distance;
+                    total_count += document_count;
+                }
+            }
+        }
+        std::vector<std::pair<std::string_view, std::pair<int, size_t>>> matches(similar_words.begin(), similar_words.end());
+        // тот же порядок, что в ExpandTypos
+        std::stable_sort(matches.begin(), matches.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.first != rhs.second.first ? lhs.second.first < rhs.second.first : lhs.second.second > rhs.second.second;
+            });
+        if (matches.size() > first.typo_config_.max_expansions) {
+            matches.resize(first.typo_config_.max_expansions);
+        }
+        auto& expanded = expansions.plus_words[std::string(word)];
+        for (const auto& [similar_word, match] : matches) {
+            expanded.emplace_back(similar_word, std::pow(first.typo_config_.typo_penalty, match.first));
+        }
+    }
+    return expansions;
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
 {
-    return FindTopDocuments(
-        raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
-        { return document_status == status; });
+    return FindTopDocuments(raw_query, DocumentFilter{ status });
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const std::string_view raw_query, DocumentStatus status) const
 {
-    return FindTopDocuments(
-        raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
-        { return document_status == status; });
+    return FindTopDocuments(raw_query, DocumentFilter{ status });
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const std::string_view raw_query, DocumentStatus status) const
 {
-    return FindTopDocuments(
-        std::execution::par, raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
-        { return document_status == status; });
+    return FindTopDocuments(std::execution::par, raw_query, DocumentFilter{ status });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const
+{
+    QueryArena::Scope arena;
+    return FindTopDocuments(PrepareQuery(raw_query, arena.Resource()), filter);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const std::string_view raw_query, const DocumentFilter& filter) const
+{
+    return FindTopDocuments(raw_query, filter);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const std::string_view raw_query, const DocumentFilter& filter) const
+{
+    QueryArena::Scope arena;
+    return FindTopDocuments(std::execution::par, PrepareQuery(std::execution::par, raw_query, arena.Resource()), filter);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const
@@ -121,6 +515,144 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::execution::paral
     return FindTopDocuments(std::execution::par, raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const
+{
+    return FindTopDocuments(query, DocumentFilter{ status });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentStatus status) const
+{
+    return FindTopDocuments(query, DocumentFilter{ status });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentStatus status) const
+{
+    return FindTopDocuments(std::execution::par, query, DocumentFilter{ status });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, const DocumentFilter& filter) const
+{
+    QueryArena::Scope arena;
+    auto matched_documents = FindAllDocuments(query, filter, arena.Resource());
+    return MatchedDocumentProcessing(matched_documents);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, const DocumentFilter& filter) const
+{
+    return FindTopDocuments(query, filter);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, const DocumentFilter& filter) const
+{
+    QueryArena::Scope arena;
+    auto matched_documents = FindAllDocuments(std::execution::par, query, filter, arena.Resource());
+    return MatchedDocumentProcessing(matched_documents);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const
+{
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query) const
+{
+    return FindTopDocuments(query);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query) const
+{
+    return FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const std::string_view raw_query) const
+{
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const std::string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocuments(policy, raw_query, DocumentFilter{ status });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const std::string_view raw_query, const DocumentFilter& filter) const
+{
+    QueryArena::Scope arena;
+    return FindTopDocuments(policy, PrepareQuery(raw_query, arena.Resource()), filter);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const PreparedQuery& query) const
+{
+    return FindTopDocuments(policy, query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const PreparedQuery& query, DocumentStatus status) const
+{
+    return FindTopDocuments(policy, query, DocumentFilter{ status });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy&, const PreparedQuery& query, const DocumentFilter& filter) const
+{
+    return RunAdaptive(ExecutionOperation::FIND_TOP_DOCUMENTS, EstimateFindWork(query), [&](ExecutionMode mode) {
+        return mode == ExecutionMode::PARALLEL ? FindTopDocuments(std::execution::par, query, filter) : FindTopDocuments(query, filter);
+        });
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const std::vector<PreparedQuery>& queries) const
+{
+    uint64_t work = 0;
+    for (const PreparedQuery& query : queries) {
+        work += EstimateFindWork(query);
+    }
+    const ExecutionMode mode = cost_model_.ChooseBatch(queries.size());
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<Document>> result(queries.size());
+    if (mode == ExecutionMode::BATCHED) {
+        std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(), [&](const PreparedQuery& query) {
+            return FindTopDocuments(query);
+            });
+    }
+    else {
+        std::transform(queries.begin(), queries.end(), result.begin(), [&](const PreparedQuery& query) {
+            return FindTopDocuments(policy, query);
+            });
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    execution_stats_.Record(ExecutionOperation::PROCESS_QUERIES, mode, work, elapsed.count());
+    return result;
+}
+
+uint64_t SearchServer::EstimateFindWork(const PreparedQuery& query)
+{
+    uint64_t work = 0;
+    for (const PreparedQuery::Term& term : query.plus_terms) {
+        work += term.documents->size();
+    }
+    for (const PreparedQuery::Term& term : query.minus_terms) {
+        work += term.documents->size();
+    }
+    return work;
+}
+
+void SearchServer::SetExecutionCostModel(const ExecutionCostModel& cost_model)
+{
+    cost_model_ = cost_model;
+}
+
+const ExecutionCostModel& SearchServer::GetExecutionCostModel() const
+{
+    return cost_model_;
+}
+
+ExecutionStats SearchServer::GetExecutionStats() const
+{
+    return execution_stats_.GetStats();
+}
+
+void SearchServer::ResetExecutionStats()
+{
+    execution_stats_.Reset();
+}
+
 void SearchServer::FindTopDocuments(const SearchServer& search_server, const std::string_view raw_query)
 {
     search_server.FindTopDocuments(raw_query);
@@ -141,23 +673,296 @@ int SearchServer::GetDocumentCount() const
     return documents_.size();
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+bool SearchServer::HasDocument(int document_id) const
 {
-    Query query = ParseQuery(raw_query);
-    std::vector<std::string_view> matched_words;
-    if (word_frequencies_.count(document_id)) {
-        bool have_minus_word = std::any_of(query.minus_words.begin(), query.minus_words.end(), [&](const std::string_view& word)
-            { return (word_frequencies_.at(document_id).count(word)); });
-        if (!have_minus_word)
-        {
-            std::copy_if(query.plus_words.begin(), query.plus_words.end(), std::back_inserter(matched_words), [&](const std::string_view& word) {
-                return word_frequencies_.at(document_id).count(word);
-                });
+    return documents_.count(document_id);
+}
+
+DocumentStatus SearchServer::GetDocumentStatus(int document_id) const
+{
+    return documents_.at(document_id).status;
+}
+
+int SearchServer::GetDocumentRating(int document_id) const
+{
+    return documents_.at(document_id).rating;
+}
+
+void SearchServer::SetWriteAheadLog(WriteAheadLog* log)
+{
+    write_ahead_log_ = log;
+}
+
+void SearchServer::EnableDocumentStore(size_t block_size)
+{
+    if (!document_store_) {
+        document_store_.emplace(block_size);
+    }
+}
+
+void SearchServer::DisableDocumentStore()
+{
+    document_store_.reset();
+}
+
+bool SearchServer::HasDocumentStore() const
+{
+    return document_store_.has_value();
+}
+
+bool SearchServer::HasDocumentText(int document_id) const
+{
+    return document_store_ && documents_.count(document_id) && document_store_->Contains(GetDocumentSlot(document_id));
+}
+
+std::string SearchServer::GetDocumentText(int document_id) const
+{
+    if (!document_store_) {
+        throw std::out_of_range("document store is disabled");
+    }
+    if (!documents_.count(document_id)) {
+        throw std::out_of_range("document text is not stored");
+    }
+    return document_store_->Get(GetDocumentSlot(document_id));
+}
+
+Snippet SearchServer::GetSnippet(const PreparedQuery& query, int document_id, size_t max_length) const
+{
+    const std::string text = GetDocumentText(document_id);
+    return MakeSnippet(document_id, text, std::get<0>(MatchDocument(query, document_id)), max_length);
+}
+
+std::vector<Snippet> SearchServer::GetSnippets(const std::string_view raw_query, const std::vector<Document>& documents, size_t max_length) const
+{
+    return GetSnippets(PrepareQuery(raw_query), documents, max_length);
+}
+
+std::vector<Snippet> SearchServer::GetSnippets(const PreparedQuery& query, const std::vector<Document>& documents, size_t max_length) const
+{
+    if (!document_store_) {
+        throw std::out_of_range("document store is disabled");
+    }
+    std::vector<int> document_ids;
+    std::vector<uint32_t> slots;
+    document_ids.reserve(documents.size());
+    slots.reserve(documents.size());
+    for (const Document& document : documents) {
+        if (!documents_.count(document.id)) {
+            throw std::out_of_range("document text is not stored");
         }
+        document_ids.push_back(document.id);
+        slots.push_back(GetDocumentSlot(document.id));
+    }
+    const std::vector<std::string> texts = document_store_->Get(slots);
+    std::vector<Snippet> snippets;
+    snippets.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        snippets.push_back(MakeSnippet(document_ids[i], texts[i], std::get<0>(MatchDocument(query, document_ids[i])), max_length));
+    }
+    return snippets;
+}
+
+void SearchServer::EnableTypoTolerance(const TypoToleranceConfig& config)
+{
+    typo_config_ = config;
+    if (!typo_index_) {
+        typo_index_.emplace();
+        for (const auto& [word, _] : word_to_document_freqs_) {
+            typo_index_->Add(word);
+        }
+    }
+}
+
+void SearchServer::DisableTypoTolerance()
+{
+    typo_index_.reset();
+}
+
+bool SearchServer::HasTypoTolerance() const
+{
+    return typo_index_.has_value();
+}
+
+int SearchServer::GetMaxTypoDistance(const std::string_view word) const
+{
+    return word.size() >= typo_config_.min_length_two_typos ? 2 : word.size() >= typo_config_.min_length_one_typo ? 1 : 0;
+}
+
+IndexMemoryStats SearchServer::GetMemoryStats() const
+{
+    return ComputeMemoryStats(nullptr);
+}
+
+IndexMemoryStats SearchServer::ComputeMemoryStats(const IndexGrowth* growth) const
+{
+    // изменения размеров структур при добавлении документа
+    size_t new_term_count = 0;
+    size_t new_dictionary_word_count = 0;
+    size_t new_dictionary_bytes = 0;
+    size_t posting_count = posting_count_;
+    size_t document_count = documents_.size();
+    size_t forward_bytes = word_frequencies_.GetAllocatedBytes();
+    size_t column_size = rating_column_.size();
+    size_t rating_capacity = rating_column_.capacity();
+    size_t status_capacity = status_column_.capacity();
+    size_t slot_count = document_slots_.size();
+    size_t slot_bucket_count = document_slots_.bucket_count();
+    size_t status_documents_bytes = 0;
+    for (const DocumentBitmap& status_documents : status_documents_) {
+        status_documents_bytes += status_documents.GetAllocatedBytes();
+    }
+    // номер изменяемого документа
+    uint32_t growth_slot = 0;
+    size_t new_document_set_count = 0;
+    size_t document_sets_growth = 0;
+    std::pmr::vector<std::string_view> new_words(growth ? growth->words.get_allocator().resource() : std::pmr::get_default_resource());
+    if (growth) {
+        const int document_id = growth->document_id;
+        // номер документа: у заменяемого - свой, у нового - тот, который выдаст AcquireDocumentSlot
+        growth_slot = growth->replaces_document ? GetDocumentSlot(document_id)
+            : free_slots_.empty() ? static_cast<uint32_t>(rating_column_.size()) : free_slots_.back();
+        for (const std::string_view word : growth->words) {
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings == word_to_document_freqs_.end()) {
+                ++new_term_count;
+                new_words.push_back(word);
+                if (growth->copy_words && !words_.Contains(word)) {
+                    ++new_dictionary_word_count;
+                    new_dictionary_bytes += GetDictionaryWordBytes(word);
+                }
+                continue;
+            }
+            const auto document_set = word_to_document_set_.find(word);
+            if (document_set != word_to_document_set_.end()) {
+                document_sets_growth += document_set->second.GetAllocatedBytesAfterAdd(document_id) - document_set->second.GetAllocatedBytes();
+            }
+            else if (postings->second.size() + !postings->second.count(document_id) >= DOCUMENT_SET_MIN_FREQ) {
+                // слово станет частым: множество строится из всех его документов
+                DocumentBitmap document_set;
+                for (const auto [id, _] : postings->second) {
+                    document_set.Add(id);
+                }
+                document_set.Add(document_id);
+                ++new_document_set_count;
+                document_sets_growth += document_set.GetAllocatedBytes();
+            }
+        }
+        if (growth->replaces_document) {
+            posting_count -= word_frequencies_.Get(growth_slot).size();
+        }
+        else {
+            ++document_count;
+            ++slot_count;
+            if (free_slots_.empty()) {
+                // push_back без запаса емкости растет вдвое
+                const auto grow = [&](size_t capacity) {
+                    return column_size < capacity ? capacity : column_size + std::max<size_t>(column_size, 1);
+                };
+                rating_capacity = grow(rating_capacity);
+                status_capacity = grow(status_capacity);
+                ++column_size;
+            }
+            // таблица номеров растет примерно вдвое, до следующего простого числа корзин
+            if (slot_bucket_count <= 1 || slot_count > slot_bucket_count * document_slots_.max_load_factor()) {
+                const size_t new_bucket_count = std::max<size_t>(slot_bucket_count * 2, slot_count / document_slots_.max_load_factor());
+                slot_bucket_count = new_bucket_count + new_bucket_count / 8 + 16;
+            }
+        }
+        posting_count += growth->words.size();
+        forward_bytes = word_frequencies_.GetAllocatedBytesAfterAdd(growth_slot, growth->words.size());
+        const DocumentBitmap& status_documents = status_documents_[static_cast<int>(growth->status)];
+        status_documents_bytes += status_documents.GetAllocatedBytesAfterAdd(document_id) - status_documents.GetAllocatedBytes();
+    }
+
+    IndexMemoryStats stats;
+    stats.term_count = word_to_document_freqs_.size() + new_term_count;
+    stats.posting_count = posting_count;
+
+    const MemoryUsage terms = GetTreeMemoryUsage(stats.term_count, sizeof(std::pair<const std::string_view, std::map<int, double>>));
+    const MemoryUsage postings = GetTreeMemoryUsage(posting_count, sizeof(std::pair<const int, double>));
+    stats.inverted_index = { terms.bytes + postings.bytes, posting_count, terms.overhead_bytes + postings.overhead_bytes };
+
+    stats.forward_index = { forward_bytes, posting_count, forward_bytes - posting_count * sizeof(WordFrequency) };
+
+    const MemoryUsage document_data = GetTreeMemoryUsage(document_count, sizeof(std::pair<const int, DocumentData>));
+    const MemoryUsage document_ids = GetTreeMemoryUsage(document_count, sizeof(int));
+    stats.documents = { document_data.bytes + document_ids.bytes, document_count, document_data.overhead_bytes + document_ids.overhead_bytes };
+
+    // узел unordered_map с целым ключом: указатель на следующий и значение, хеш не хранится
+    const size_t slot_node_size = GetAllocatedBlockSize(sizeof(void*) + sizeof(std::pair<const int, uint32_t>));
+    const size_t slot_bytes = slot_count * slot_node_size + (slot_bucket_count > 1 ? slot_bucket_count * sizeof(void*) : 0)
+        + free_slots_.capacity() * sizeof(uint32_t);
+    const size_t column_bytes = rating_capacity * sizeof(int) + status_capacity * sizeof(DocumentStatus) + status_documents_bytes + slot_bytes;
+    // таблица номеров целиком служебная
+    stats.document_columns = { column_bytes, column_size, slot_bytes };
+
+    MemoryUsage document_sets = GetTreeMemoryUsage(word_to_document_set_.size() + new_document_set_count, sizeof(std::pair<const std::string_view, DocumentBitmap>));
+    for (const auto& [_, document_set] : word_to_document_set_) {
+        document_sets.bytes += document_set.GetAllocatedBytes();
+    }
+    document_sets.bytes += document_sets_growth;
+    stats.document_sets = document_sets;
+
+    const size_t dictionary_word_count = dictionary_word_count_ + new_dictionary_word_count;
+    const MemoryUsage dictionary_nodes = GetTreeMemoryUsage(dictionary_word_count, sizeof(std::string));
+    stats.dictionary = { dictionary_bytes_ + new_dictionary_bytes, dictionary_word_count, dictionary_nodes.overhead_bytes };
+
+    if (document_store_) {
+        const size_t store_bytes = growth ? document_store_->GetAllocatedBytesAfterAdd(growth_slot, growth->document) : document_store_->GetAllocatedBytes();
+        const size_t stored_document_count = document_store_->GetDocumentCount() + (growth && !growth->replaces_document);
+        stats.document_store = { store_bytes, stored_document_count, store_bytes - std::min(store_bytes, document_store_->GetStoredBytes()) };
+    }
+
+    if (typo_index_) {
+        stats.typo_index = { typo_index_->GetAllocatedBytesAfterAdd(new_words), typo_index_->GetWordCount() + new_words.size(), 0 };
+    }
+
+    stats.total_bytes = stats.inverted_index.bytes + stats.forward_index.bytes + stats.documents.bytes
+        + stats.document_columns.bytes + stats.document_sets.bytes + stats.dictionary.bytes + stats.document_store.bytes
+        + stats.typo_index.bytes;
+    if (stats.term_count > 0) {
+        stats.average_postings_per_term = static_cast<double>(posting_count) / stats.term_count;
+    }
+    if (posting_count > 0) {
+        stats.bytes_per_posting = static_cast<double>(stats.inverted_index.bytes + stats.forward_index.bytes) / posting_count;
+    }
+    return stats;
+}
+
+void SearchServer::SetMemoryBudget(size_t bytes)
+{
+    memory_budget_ = bytes;
+}
+
+size_t SearchServer::GetMemoryBudget() const
+{
+    return memory_budget_;
+}
+
+size_t SearchServer::GetDictionaryWordBytes(const std::string_view word)
+{
+    // короткие строки хранятся внутри std::string без отдельного блока
+    const size_t SSO_CAPACITY = 15;
+    const size_t string_bytes = word.size() > SSO_CAPACITY ? GetAllocatedBlockSize(word.size() + 1) : 0;
+    return GetTreeMemoryUsage(1, sizeof(std::string)).bytes + string_bytes;
+}
+
+void SearchServer::CheckMemoryBudget(int document_id, const std::string_view document, DocumentStatus status, const std::pmr::vector<std::string_view>& words, bool copy_words, bool replaces_document, std::pmr::memory_resource* resource) const
+{
+    IndexGrowth growth{ document_id, status, std::pmr::vector<std::string_view>(words.begin(), words.end(), resource), copy_words, replaces_document, document };
+    std::sort(growth.words.begin(), growth.words.end());
+    growth.words.erase(std::unique(growth.words.begin(), growth.words.end()), growth.words.end());
+    const size_t required_bytes = ComputeMemoryStats(&growth).total_bytes;
+    if (required_bytes > memory_budget_) {
+        throw std::length_error("memory budget exceeded: index would take " + std::to_string(required_bytes) + " bytes");
     }
-    return std::tuple{matched_words, documents_.at(document_id).status};
 }
 
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
+    QueryArena::Scope arena;
+    return MatchDocument(PrepareQuery(raw_query, arena.Resource()), document_id);
+}
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy& seq, const std::string_view raw_query, int document_id) const
 {
@@ -169,37 +974,94 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     if (!documents_id_.count(document_id)) {
         throw std::out_of_range("id not exists");
     }
-    QueryParallel query = ParseQuery(par, raw_query);
+    QueryArena::Scope arena;
+    return MatchDocument(par, PrepareQuery(par, raw_query, arena.Resource()), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const
+{
+    CheckRevision(query);
+    query.cancellation.ThrowIfCancelled();
+    const DocumentStatus status = documents_.at(document_id).status;
     std::vector<std::string_view> matched_words;
-    if (word_frequencies_.count(document_id)) {
-        bool have_minus_word = std::any_of(query.minus_words.begin(), query.minus_words.end(), [&](const std::string_view& word)
-            { return (word_frequencies_.at(document_id).count(word)); });
-        if (!have_minus_word)
-        {
-            std::copy_if(query.plus_words.begin(), query.plus_words.end(), std::back_inserter(matched_words), [&](const std::string_view& word) {
-                return word_frequencies_.at(document_id).count(word);
-                });
+    // поиск по короткому отрезку слов документа вместо списков постингов
+    const WordFrequenciesView words = word_frequencies_.Get(GetDocumentSlot(document_id));
+    bool have_minus_word = std::any_of(query.minus_terms.begin(), query.minus_terms.end(), [&](const PreparedQuery::Term& term)
+        { return words.count(term.word); });
+    if (!have_minus_word)
+    {
+        matched_words.reserve(query.plus_terms.size());
+        uint64_t matched_clauses = 0;
+        for (const PreparedQuery::Term& term : query.plus_terms) {
+            // раскрытие префиксов и опечаток может дать много слов, отмена проверяется между ними
+            query.cancellation.ThrowIfCancelled();
+            if (words.count(term.word)) {
+                matched_words.push_back(term.word);
+                matched_clauses |= term.clauses;
+            }
+        }
+        // в режиме min_should_match документ без нужного числа слов запроса не подходит
+        if (query.min_should_match > 1 && static_cast<size_t>(__builtin_popcountll(matched_clauses)) < query.min_should_match) {
+            matched_words.clear();
         }
     }
-    return std::tuple{matched_words, documents_.at(document_id).status};
+    return std::tuple{std::move(matched_words), status};
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const
 {
-    return ratings.empty() ? 0 : std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
+    return MatchDocument(query, document_id);
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy& par, const PreparedQuery& query, int document_id) const
 {
-    std::vector<std::string_view> words;
-    for (const std::string_view& word : SplitIntoWords(text))
+    CheckRevision(query);
+    if (!documents_id_.count(document_id)) {
+        throw std::out_of_range("id not exists");
+    }
+    query.cancellation.ThrowIfCancelled();
+    std::vector<std::string_view> matched_words;
+    const WordFrequenciesView words = word_frequencies_.Get(GetDocumentSlot(document_id));
+    bool have_minus_word = std::any_of(par, query.minus_terms.begin(), query.minus_terms.end(), [&](const PreparedQuery::Term& term)
+        { return words.count(term.word); });
+    if (!have_minus_word)
     {
-        if (!IsStopWord(word))
-        {
-            words.push_back(word);
+        query.cancellation.ThrowIfCancelled();
+        matched_words.resize(query.plus_terms.size());
+        auto last = std::transform(par, query.plus_terms.begin(), query.plus_terms.end(), matched_words.begin(), [&](const PreparedQuery::Term& term) {
+            return words.count(term.word) ? term.word : std::string_view{};
+            });
+        matched_words.erase(std::remove(par, matched_words.begin(), last, std::string_view{}), matched_words.end());
+        if (query.min_should_match > 1) {
+            uint64_t matched_clauses = 0;
+            for (const PreparedQuery::Term& term : query.plus_terms) {
+                matched_clauses |= words.count(term.word) ? term.clauses : 0;
+            }
+            if (static_cast<size_t>(__builtin_popcountll(matched_clauses)) < query.min_should_match) {
+                matched_words.clear();
+            }
         }
     }
-    return words;
+    return std::tuple{std::move(matched_words), documents_.at(document_id).status};
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const AdaptivePolicy& policy, const std::string_view raw_query, int document_id) const
+{
+    QueryArena::Scope arena;
+    return MatchDocument(policy, PrepareQuery(raw_query, arena.Resource()), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const AdaptivePolicy&, const PreparedQuery& query, int document_id) const
+{
+    const uint64_t work = query.plus_terms.size() + query.minus_terms.size();
+    return RunAdaptive(ExecutionOperation::MATCH_DOCUMENT, work, [&](ExecutionMode mode) {
+        return mode == ExecutionMode::PARALLEL ? MatchDocument(std::execution::par, query, document_id) : MatchDocument(query, document_id);
+        });
+}
+
+int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
+{
+    return ratings.empty() ? 0 : std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
 }
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const
@@ -207,14 +1069,18 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text
     return (!text.empty() && text.front() == '-') ? QueryWord{text.substr(1), true, IsStopWord(text)} : QueryWord{ text, false, IsStopWord(text) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const
+SearchServer::Query SearchServer::ParseQuery(const std::string_view text, std::pmr::memory_resource* resource) const
 {
-    Query query;
-    for (const std::string_view& word : SplitIntoWords(text))
+    Query query{ std::pmr::set<std::string_view>(resource), std::pmr::set<std::string_view>(resource) };
+    for (const std::string_view& word : SplitIntoWords(text, resource))
     {
         const QueryWord query_word = ParseQueryWord(word);
         if (query_word.data.empty() || query_word.data.front() == '-')
             throw std::invalid_argument("it is not allowed to use \"--word\" or only \"-\" in the request.\nCorrectly: \"-word\"");
+        if (query_word.data == "*")
+            throw std::invalid_argument("prefix query needs at least one character before \"*\"");
+        if (query_word.data == "~")
+            throw std::invalid_argument("typo query needs at least one character before \"~\"");
         if (!query_word.is_stop)
         {
             (query_word.is_minus) ? query.minus_words.insert(query_word.data) : query.plus_words.insert(query_word.data);
@@ -223,10 +1089,10 @@ SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const
     return query;
 }
 
-SearchServer::QueryParallel SearchServer::ParseQuery(const std::execution::parallel_policy&, const std::string_view text) const
+SearchServer::QueryParallel SearchServer::ParseQuery(const std::execution::parallel_policy&, const std::string_view text, std::pmr::memory_resource* resource) const
 {
-    QueryParallel query;
-    std::vector<std::string_view> separate_text = std::move(SplitIntoWords(text));
+    QueryParallel query{ std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource) };
+    std::pmr::vector<std::string_view> separate_text = SplitIntoWords(text, resource);
     std::sort(separate_text.begin(), separate_text.end());
     separate_text.erase(std::unique(separate_text.begin(), separate_text.end()), separate_text.end());
     auto bound = std::find_if_not(separate_text.begin(), separate_text.end(), [](const auto& word) {
@@ -246,6 +1112,198 @@ SearchServer::QueryParallel SearchServer::ParseQuery(const std::execution::paral
     return query;
 }
 
+template <typename QueryType>
+PreparedQuery SearchServer::ResolveQuery(const QueryType& query, std::pmr::memory_resource* resource, const QueryExpansions* expansions) const
+{
+    PreparedQuery prepared(resource);
+    prepared.index_id = instance_id_.Get();
+    prepared.revision = revision_;
+    // слова, которых нет ни в одном документе, на результат не влияют.
+    // Опечатки исправляются только в плюс-словах (correct_typos), у минус-слов "~" отбрасывается.
+    // Префикс раскрывается не больше чем в max_prefix_expansion слов
+    // Раскрытия, найденные заранее (word_expansions), заменяют раскрытия по своему словарю
+    auto resolve = [&](const auto& words, std::pmr::vector<PreparedQuery::Term>& terms, bool correct_typos, size_t max_prefix_expansion, const QueryExpansions::WordExpansions* word_expansions) {
+        terms.reserve(words.size());
+        bool has_expansion = false;
+        size_t clause = 0;
+        auto add_expansions = [&](const std::string_view word, uint64_t clauses) {
+            const auto expansion = word_expansions->find(word);
+            if (expansion == word_expansions->end()) {
+                return;
+            }
+            for (const auto& [expanded_word, weight] : expansion->second) {
+                const auto it = word_to_document_freqs_.find(expanded_word);
+                if (it != word_to_document_freqs_.end() && !it->second.empty()) {
+                    terms.push_back({ it->first, ComputeWordInverseDocumentFreq(it->first) * weight, &it->second, FindDocumentSet(it->first), clauses, weight });
+                }
+            }
+        };
+        for (const std::string_view& word : words) {
+            const uint64_t clauses = clause < PreparedQuery::MAX_CLAUSE_COUNT ? uint64_t{ 1 } << clause : 0;
+            ++clause;
+            if (word.size() > 1 && word.back() == '*') {
+                has_expansion = true;
+                if (word_expansions) {
+                    add_expansions(word, clauses);
+                    continue;
+                }
+                ExpandPrefix(word.substr(0, word.size() - 1), max_prefix_expansion, [&](const auto& entry) {
+                    terms.push_back({ entry.first, ComputeWordInverseDocumentFreq(entry.first), &entry.second, FindDocumentSet(entry.first), clauses });
+                    });
+                continue;
+            }
+            const bool is_typo_query = word.size() > 1 && word.back() == '~';
+            const std::string_view exact_word = is_typo_query ? word.substr(0, word.size() - 1) : word;
+            const auto it = word_to_document_freqs_.find(exact_word);
+            const bool found = it != word_to_document_freqs_.end() && !it->second.empty();
+            if (found) {
+                terms.push_back({ it->first, ComputeWordInverseDocumentFreq(it->first), &it->second, FindDocumentSet(it->first), clauses });
+            }
+            if (word_expansions) {
+                has_expansion = true;
+                add_expansions(word, clauses);
+            }
+            else if (correct_typos && typo_index_ && (is_typo_query || (!found && typo_config_.correct_missing_words))) {
+                has_expansion = true;
+                ExpandTypos(exact_word, [&](const auto& entry, double weight) {
+                    terms.push_back({ entry.first, ComputeWordInverseDocumentFreq(entry.first) * weight, &entry.second, FindDocumentSet(entry.first), clauses, weight });
+                    });
+            }
+        }
+        // раскрытия префиксов и опечаток могут совпасть друг с другом и с обычными словами
+        // запроса, такое слово остается одно с наибольшим весом и относится ко всем своим словам запроса
+        if (has_expansion) {
+            std::sort(terms.begin(), terms.end(), [](const auto& lhs, const auto& rhs) { return lhs.word < rhs.word; });
+            size_t unique_count = 0;
+            for (size_t i = 0; i < terms.size(); ++i) {
+                if (unique_count > 0 && terms[unique_count - 1].word == terms[i].word) {
+                    PreparedQuery::Term& term = terms[unique_count - 1];
+                    const uint64_t merged_clauses = term.clauses | terms[i].clauses;
+                    if (terms[i].weight > term.weight) {
+                        term = terms[i];
+                    }
+                    term.clauses = merged_clauses;
+                }
+                else {
+                    terms[unique_count++] = terms[i];
+                }
+            }
+            terms.resize(unique_count);
+        }
+        return clause;
+    };
+    prepared.clause_count = resolve(query.plus_words, prepared.plus_terms, true, MAX_PREFIX_EXPANSION, expansions ? &expansions->plus_words : nullptr);
+    resolve(query.minus_words, prepared.minus_terms, false, std::numeric_limits<size_t>::max(), expansions ? &expansions->minus_words : nullptr);
+    return prepared;
+}
+
+bool SearchServer::IntersectClauseSets(const PreparedQuery& query, uint64_t skip_clauses, DocumentBitmap& result, std::pmr::memory_resource* resource) const
+{
+    bool has_clause = false;
+    for (size_t clause = 0; clause < query.clause_count; ++clause) {
+        const uint64_t clause_bit = uint64_t{ 1 } << clause;
+        if (skip_clauses & clause_bit) {
+            continue;
+        }
+        // документы слова запроса - объединение множеств его слов словаря (раскрытий префикса и опечаток)
+        DocumentBitmap clause_documents(resource);
+        bool complete = true;
+        bool has_term = false;
+        for (const PreparedQuery::Term& term : query.plus_terms) {
+            if (!(term.clauses & clause_bit)) {
+                continue;
+            }
+            if (!term.document_set) {
+                complete = false;
+                break;
+            }
+            clause_documents.UnionWith(*term.document_set);
+            has_term = true;
+        }
+        if (!complete || !has_term) {
+            continue;
+        }
+        if (has_clause) {
+            result.IntersectWith(clause_documents);
+        }
+        else {
+            result = std::move(clause_documents);
+            has_clause = true;
+        }
+    }
+    return has_clause;
+}
+
+const double* SearchServer::SeekPosting(const std::map<int, double>& postings, std::map<int, double>::const_iterator& cursor, int document_id)
+{
+    const int LINEAR_STEPS = 4;
+    for (int step = 0; step < LINEAR_STEPS && cursor != postings.end() && cursor->first < document_id; ++step) {
+        ++cursor;
+    }
+    if (cursor != postings.end() && cursor->first < document_id) {
+        cursor = postings.lower_bound(document_id);
+    }
+    return cursor != postings.end() && cursor->first == document_id ? &cursor->second : nullptr;
+}
+
+const DocumentBitmap* SearchServer::FindDocumentSet(const std::string_view word) const
+{
+    const auto it = word_to_document_set_.find(word);
+    return it == word_to_document_set_.end() ? nullptr : &it->second;
+}
+
+DocumentBitmap SearchServer::BuildExcludedDocuments(const PreparedQuery& query, std::pmr::memory_resource* resource) const
+{
+    DocumentBitmap excluded(resource);
+    for (const PreparedQuery::Term& term : query.minus_terms) {
+        if (term.document_set) {
+            excluded.UnionWith(*term.document_set);
+            continue;
+        }
+        for (const auto [document_id, _] : *term.documents) {
+            excluded.Add(document_id);
+        }
+    }
+    return excluded;
+}
+
+void SearchServer::CheckRevision(const PreparedQuery& query) const
+{
+    if (query.index_id != instance_id_.Get()) {
+        throw std::invalid_argument("prepared query belongs to another index");
+    }
+    if (query.revision != revision_) {
+        throw std::invalid_argument("prepared query is out of date, the index has been changed");
+    }
+}
+
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const PreparedQuery& query, const DocumentFilter& filter, std::pmr::memory_resource* resource) const
+{
+    const size_t allowed_count = CountAllowedDocuments(filter);
+    return CollectDocuments(query, [&](const std::map<int, double>& postings, auto accumulate) {
+        ForEachFilteredPosting(postings, filter, allowed_count, accumulate);
+        }, resource);
+}
+
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& par, const PreparedQuery& query, const DocumentFilter& filter, std::pmr::memory_resource* resource) const
+{
+    const size_t allowed_count = CountAllowedDocuments(filter);
+    return CollectDocuments(par, query, [&](const std::map<int, double>& postings, auto accumulate) {
+        ForEachFilteredPosting(postings, filter, allowed_count, accumulate);
+        }, resource);
+}
+
+size_t SearchServer::CountAllowedDocuments(const DocumentFilter& filter) const
+{
+    size_t count = 0;
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (filter.HasStatus(static_cast<DocumentStatus>(status))) {
+            count += status_documents_[status].Size();
+        }
+    }
+    return count;
+}
+
 double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const
 {
     return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
@@ -256,21 +1314,20 @@ bool SearchServer::IsStopWord(const std::string_view word) const
     return stop_words_.count(word);
 }
 
-void SearchServer::MatchedDocumentProcessing(std::vector<Document>& matched_documents) const {
-    std::sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs)
-        {
-            if (std::abs(lhs.relevance - rhs.relevance) < COMPARISON_ERROR)
-            {
-                return lhs.rating > rhs.rating;
-            }
-            else
-            {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) < COMPARISON_ERROR)
+    {
+        return lhs.rating > rhs.rating;
+    }
+    else
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        return lhs.relevance > rhs.relevance;
     }
 }
+
+std::vector<Document> SearchServer::MatchedDocumentProcessing(std::pmr::vector<Document>& matched_documents) const {
+    const size_t result_size = std::min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::partial_sort(matched_documents.begin(), matched_documents.begin() + result_size, matched_documents.end(), IsMoreRelevant);
+    return std::vector<Document>(matched_documents.begin(), matched_documents.begin() + result_size);
+}
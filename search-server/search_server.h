@@ -13,13 +13,42 @@
 #include <cstddef>
 #include <future>
 #include <type_traits>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <numeric>
+#include <chrono>
+#include <optional>
+#include <unordered_map>
 
 #include "read_input_functions.h"
 #include "string_processing.h"
 #include "document.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "prepared_query.h"
+#include "query_arena.h"
+#include "memory_stats.h"
+#include "forward_index.h"
+#include "adaptive_execution.h"
+#include "write_ahead_log.h"
+#include "document_store.h"
+#include "typo_index.h"
 #include "log_duration.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+// максимальное количество слов словаря, в которое раскрывается префиксный плюс-запрос "serv*";
+// минус-префикс раскрывается полностью, иначе он пропустил бы документы с отброшенными словами
+const int MAX_PREFIX_EXPANSION = 64;
+// начиная с такой документной частоты у слова есть битовое множество его документов
+const size_t DOCUMENT_SET_MIN_FREQ = 512;
+// после удалений битовое множество слова с меньшей частотой освобождается;
+// разрыв между порогами не дает множеству пересоздаваться на каждом добавлении и удалении
+const size_t DOCUMENT_SET_DROP_FREQ = DOCUMENT_SET_MIN_FREQ / 2;
+// через сколько постингов поиск проверяет отмену запроса
+const size_t CANCELLATION_CHECK_INTERVAL = 4096;
+// длина фрагмента текста в выдаче по умолчанию
+const size_t DEFAULT_SNIPPET_LENGTH = 160;
 #define COMPARISON_ERROR (1e-6)
 
 using namespace std::literals::string_literals;
@@ -55,6 +84,34 @@ private:
     std::vector<std::map<Key, Value>> backets_;
 };
 
+// уникальный идентификатор экземпляра. Копия получает новый идентификатор: ее индекс -
+// другие объекты, и подготовленные для оригинала запросы к ней не подходят
+class InstanceId {
+public:
+    InstanceId() : value_(Next()) {
+    }
+
+    InstanceId(const InstanceId&) : value_(Next()) {
+    }
+
+    InstanceId& operator=(const InstanceId&) {
+        value_ = Next();
+        return *this;
+    }
+
+    uint64_t Get() const {
+        return value_;
+    }
+
+private:
+    uint64_t value_;
+
+    static uint64_t Next() {
+        static std::atomic<uint64_t> counter = 0;
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+};
+
 class SearchServer {
 public:
 
@@ -63,7 +120,7 @@ public:
 
     // конструктор, задает стоп слова, переданные в контейнере
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words) :stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+    explicit SearchServer(const StringContainer& stop_words) :stop_words_(MakeUniqueNonEmptyStrings(stop_words, words_))
     {
     }
 
@@ -81,6 +138,39 @@ public:
 
     static void AddDocument(SearchServer& search_server, int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // добавление документа, текст которого лежит в хранилище storage (например, отображенном в память файле).
+    // Сервер держит хранилище до своего уничтожения, а новые слова словаря ссылаются прямо на него без копирования
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings, const std::shared_ptr<const void>& storage);
+
+    // изменение документа на месте: новый текст сравнивается с прямым индексом документа,
+    // меняются только постинги добавленных, удаленных слов и слов с изменившимся TF.
+    // Для отсутствующего id - std::out_of_range
+    void UpdateDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // изменение только статуса и рейтинга, индекс слов не затрагивается и подготовленные запросы остаются действительными
+    void UpdateDocument(int document_id, DocumentStatus status, const std::vector<int>& ratings);
+
+    // разбор запроса для многократного использования
+    PreparedQuery PrepareQuery(const std::string_view raw_query) const;
+    PreparedQuery PrepareQuery(const std::execution::parallel_policy&, const std::string_view raw_query) const;
+
+    // раскрытия префиксов ("serv*") и опечаток ("sevrer~") запроса, найденные сразу по словарям
+    // нескольких серверов: ключ - слово запроса, значение - слова словарей с весами
+    struct QueryExpansions {
+        using WordExpansions = std::map<std::string, std::vector<std::pair<std::string_view, double>>, std::less<>>;
+        WordExpansions plus_words;
+        WordExpansions minus_words;
+    };
+
+    // раскрытие запроса по объединенному словарю серверов (шардов одной коллекции): префикс - первые
+    // слова объединения в порядке словаря, опечатка - ближайшие и самые частые во всей коллекции слова.
+    // Стоп-слова и настройки опечаток берутся у первого сервера; слова раскрытий ссылаются на словари
+    // серверов и действительны до их изменения
+    static QueryExpansions ExpandQuery(const std::string_view raw_query, const std::vector<SearchServer>& servers);
+
+    // подготовка запроса, в котором префиксы и опечатки раскрываются не по своему словарю, а в заданные слова
+    // (отсутствующие в индексе сервера пропускаются)
+    PreparedQuery PrepareQuery(const std::string_view raw_query, const QueryExpansions& expansions) const;
+
     //================FIND_TOP============================
     static void FindTopDocuments(const SearchServer& search_server, const std::string_view raw_query);
     static void FindTopDocuments(const std::execution::sequenced_policy&, const SearchServer& search_server, const std::string_view raw_query);
@@ -94,12 +184,56 @@ public:
     std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const std::string_view raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const std::string_view raw_query, DocumentStatus status) const;
 
+    // фильтр по статусам, рейтингу и id применяется при обходе индекса
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const std::string_view raw_query, const DocumentFilter& filter) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    // произвольный предикат вызывается для каждого найденного документа
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
 
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
 
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query) const;
+
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, const DocumentFilter& filter) const;
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, const DocumentFilter& filter) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, const DocumentFilter& filter) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    // адаптивное выполнение: последовательно или параллельно в зависимости от оценки работы
+    // по модели стоимости, решение попадает в статистику GetExecutionStats
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const PreparedQuery& query) const;
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const PreparedQuery& query, const DocumentFilter& filter) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const AdaptivePolicy&, const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    // пакет запросов: при достаточном количестве запросов они выполняются параллельно между
+    // собой (каждый последовательно), иначе по очереди с адаптивным выбором для каждого
+    std::vector<std::vector<Document>> FindTopDocuments(const AdaptivePolicy&, const std::vector<PreparedQuery>& queries) const;
+
 
     std::set<int>::iterator begin() const;
 
@@ -107,12 +241,14 @@ public:
 
     //const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // слова документа с частотами, отсортированные по слову; представление действительно до изменения индекса
+    WordFrequenciesView GetWordFrequencies(int document_id) const;
 
     //remove docs
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy& seq, int document_id);
     void RemoveDocument(const std::execution::parallel_policy& par, int document_id);
+    void RemoveDocument(const AdaptivePolicy&, int document_id);
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
 
@@ -120,9 +256,68 @@ public:
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy& par, const std::string_view raw_query, int document_id) const;
 
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy& seq, const PreparedQuery& query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy& par, const PreparedQuery& query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const AdaptivePolicy&, const std::string_view raw_query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const AdaptivePolicy&, const PreparedQuery& query, int document_id) const;
+
+    // модель стоимости адаптивного выполнения и статистика принятых решений
+    void SetExecutionCostModel(const ExecutionCostModel& cost_model);
+    const ExecutionCostModel& GetExecutionCostModel() const;
+    ExecutionStats GetExecutionStats() const;
+    void ResetExecutionStats();
+
     // получить количество документов
     int GetDocumentCount() const;
 
+    bool HasDocument(int document_id) const;
+    // статус и средний рейтинг документа; для отсутствующего id - std::out_of_range
+    DocumentStatus GetDocumentStatus(int document_id) const;
+    int GetDocumentRating(int document_id) const;
+
+    // журнал, в который записываются успешные AddDocument, UpdateDocument и RemoveDocument (nullptr - без журнала).
+    // Журнал принадлежит вызывающему и должен жить дольше сервера или до отключения
+    void SetWriteAheadLog(WriteAheadLog* log);
+
+    // хранение исходных текстов документов в сжатом виде. Сохраняются тексты документов,
+    // добавленных после включения; выключение освобождает хранилище
+    void EnableDocumentStore(size_t block_size = DocumentStore::DEFAULT_BLOCK_SIZE);
+    void DisableDocumentStore();
+    bool HasDocumentStore() const;
+    bool HasDocumentText(int document_id) const;
+    // для документа без сохраненного текста - std::out_of_range
+    std::string GetDocumentText(int document_id) const;
+
+    // фрагменты текстов найденных документов с подсвеченными словами запроса (по MatchDocument).
+    // Тексты страницы читаются вместе, каждый блок хранилища распаковывается один раз.
+    // Для документа без сохраненного текста - std::out_of_range
+    Snippet GetSnippet(const PreparedQuery& query, int document_id, size_t max_length = DEFAULT_SNIPPET_LENGTH) const;
+    std::vector<Snippet> GetSnippets(const std::string_view raw_query, const std::vector<Document>& documents, size_t max_length = DEFAULT_SNIPPET_LENGTH) const;
+    std::vector<Snippet> GetSnippets(const PreparedQuery& query, const std::vector<Document>& documents, size_t max_length = DEFAULT_SNIPPET_LENGTH) const;
+
+    // поиск с опечатками: строит индекс триграмм словаря, дальше он пополняется новыми словами.
+    // Слово запроса "word~" дополняется похожими словами словаря, а при correct_missing_words
+    // так же заменяется слово, которого нет в словаре. Без включения "word~" ищет само слово
+    void EnableTypoTolerance(const TypoToleranceConfig& config = {});
+    void DisableTypoTolerance();
+    bool HasTypoTolerance() const;
+
+    // оценка памяти, занятой структурами индекса
+    IndexMemoryStats GetMemoryStats() const;
+
+    // ограничение памяти индекса в байтах (0 - без ограничения). AddDocument или UpdateDocument, после которого
+    // total_bytes из GetMemoryStats превысил бы бюджет, отклоняется с исключением std::length_error
+    void SetMemoryBudget(size_t bytes);
+    size_t GetMemoryBudget() const;
+
+    // порядок выдачи: по убыванию релевантности, при равной релевантности - по убыванию рейтинга
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
 private://=========================================SEARCH_SERVER_PRIVATE==============================================================
 
     // структура, содержит средний райтинг докумета и его статус
@@ -131,13 +326,19 @@ private://=========================================SEARCH_SERVER_PRIVATE========
         DocumentStatus status;
     };
 
+    // строки слов, скопированных сервером (стоп-слова и слова документов при copy_words)
+    WordDictionary words_;
+
     std::set<std::string_view> stop_words_;
 
     // мэп: ключ - слово из документа, значение - мэп: ключ - id документа, значение TF для слова
     std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
 
-    //ключ - id документа, значение: ключ - слово, значение TF для слова
-    std::map<int, std::map<std::string_view, double>> word_frequencies_;
+    // битовые множества документов для частых слов (документная частота не меньше DOCUMENT_SET_MIN_FREQ)
+    std::map<std::string_view, DocumentBitmap> word_to_document_set_;
+
+    // прямой индекс: id документа -> слова документа с TF
+    ForwardIndex word_frequencies_;
 
     // мэп: ключ - id документа, значение - структура из рейтинга и статуса документа
     std::map<int, DocumentData> documents_;
@@ -145,11 +346,105 @@ private://=========================================SEARCH_SERVER_PRIVATE========
     //id документов
     std::set<int> documents_id_;
 
+    // внутренние номера документов: id -> плотный номер, под которым документ лежит в колонках.
+    // Номера удаленных документов переиспользуются, поэтому колонки растут с количеством
+    // документов, а не с наибольшим id
+    std::unordered_map<int, uint32_t> document_slots_;
+    std::vector<uint32_t> free_slots_;
+
+    // колонки рейтинга и статуса, индекс - внутренний номер документа
+    std::vector<int> rating_column_;
+    std::vector<DocumentStatus> status_column_;
+
+    // множества id документов для каждого статуса
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_documents_;
+
+    // количество постингов (пар слово - документ)
+    size_t posting_count_ = 0;
+
+    // слова документов, скопированные сервером в словарь words_
+    size_t dictionary_word_count_ = 0;
+    size_t dictionary_bytes_ = 0;
+
+    size_t memory_budget_ = 0;
+
+    // внешние хранилища текста, на которые ссылается словарь
+    std::vector<std::shared_ptr<const void>> storages_;
+
+    // ревизия индекса, увеличивается при каждом добавлении и удалении документа
+    uint64_t revision_ = 0;
+    InstanceId instance_id_;
+
+    ExecutionCostModel cost_model_;
+    mutable ExecutionStatsRecorder execution_stats_;
+
+    WriteAheadLog* write_ahead_log_ = nullptr;
+
+    // сжатые исходные тексты документов, если хранилище включено
+    std::optional<DocumentStore> document_store_;
+
+    // индекс триграмм словаря, если включен поиск с опечатками
+    std::optional<TrigramIndex> typo_index_;
+    TypoToleranceConfig typo_config_;
+
     // определить принадлежность слова к списку стоп-слов
     bool IsStopWord(const std::string_view word) const;
 
-    // разбить текст на слова, исключив из него стоп-слова
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+    // добавление документа; при copy_words новые слова копируются в словарь сервера,
+    // иначе словарь ссылается на текст документа
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings, bool copy_words);
+
+    // память под строку слова, скопированного в словарь сервера
+    static size_t GetDictionaryWordBytes(const std::string_view word);
+
+    // добавляемый документ (при replaces_document - новое содержимое существующего)
+    struct IndexGrowth {
+        int document_id;
+        DocumentStatus status;
+        // различные слова документа
+        std::pmr::vector<std::string_view> words;
+        bool copy_words;
+        bool replaces_document;
+        // текст для хранилища документов
+        std::string_view document;
+    };
+
+    // оценка памяти структур индекса: текущая или, если задан growth, после изменения документа.
+    // По ней же GetMemoryStats отчитывается, а CheckMemoryBudget сверяется с бюджетом
+    IndexMemoryStats ComputeMemoryStats(const IndexGrowth* growth) const;
+
+    // проверка, что добавление документа из слов words не превысит бюджет памяти
+    // при replaces_document слова заменяют слова существующего документа
+    void CheckMemoryBudget(int document_id, const std::string_view document, DocumentStatus status, const std::pmr::vector<std::string_view>& words, bool copy_words, bool replaces_document, std::pmr::memory_resource* resource) const;
+
+    // слова документа без стоп-слов
+    std::pmr::vector<std::string_view> SplitIntoIndexWords(const std::string_view document, std::pmr::memory_resource* resource) const;
+
+    // сортировка слов документа и объединение повторов слова в одну запись с суммарной частотой
+    static void MergeWordFrequencies(std::pmr::vector<WordFrequency>& document_words);
+
+    // запись словаря для слова документа; новое слово добавляется в словарь
+    // (при copy_words копируется в словарь сервера words_)
+    std::map<std::string_view, std::map<int, double>>::iterator AddDictionaryWord(const std::string_view word, bool copy_words);
+
+    // добавление документа в битовое множество слова, если у слова оно есть или слово стало частым;
+    // существующее множество обновляется при любой частоте, иначе минус-слово пропустит документ
+    void AddToDocumentSet(const std::pair<const std::string_view, std::map<int, double>>& postings, int document_id);
+
+    // удаление постинга документа из списка слова и из его битового множества
+    void RemovePosting(const std::string_view word, int document_id);
+
+    // удаление документа из битового множества слова; ставшее редким множество освобождается
+    void RemoveFromDocumentSet(const std::string_view word, int document_id);
+
+    // внутренний номер существующего документа
+    uint32_t GetDocumentSlot(int document_id) const;
+    // номер для нового документа: освобожденный удалением или следующий за последним
+    uint32_t AcquireDocumentSlot(int document_id);
+    void ReleaseDocumentSlot(int document_id);
+
+    // статус и рейтинг существующего документа
+    void SetDocumentAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings);
 
     // вычисление среднего рейтинга на основе переданного вектора рейтингов
     static int ComputeAverageRating(const std::vector<int>& ratings);
@@ -168,114 +463,402 @@ private://=========================================SEARCH_SERVER_PRIVATE========
     // структура двух сетов из плюс слов и минус слов
     // std::set<std::string_view> plus_words;
     // std::set<std::string_view> minus_words;
+    // память под временные структуры запроса берется из арены запроса
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        std::pmr::set<std::string_view> plus_words;
+        std::pmr::set<std::string_view> minus_words;
     };
 
     struct QueryParallel {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
     };
 
-    Query ParseQuery(const std::string_view text) const;
+    Query ParseQuery(const std::string_view text, std::pmr::memory_resource* resource) const;
 
-    QueryParallel ParseQuery(const std::execution::parallel_policy& par, const std::string_view text) const;
+    QueryParallel ParseQuery(const std::execution::parallel_policy& par, const std::string_view text, std::pmr::memory_resource* resource) const;
+
+    // подготовка запроса, память под который берется из переданного ресурса
+    PreparedQuery PrepareQuery(const std::string_view raw_query, std::pmr::memory_resource* resource) const;
+    PreparedQuery PrepareQuery(const std::execution::parallel_policy&, const std::string_view raw_query, std::pmr::memory_resource* resource) const;
 
     // Existence required
     double ComputeWordInverseDocumentFreq(const std::string_view word) const;
 
-    template <typename DocumentPredicate, typename QueryType>
-    std::vector<Document> FindAllDocuments(const QueryType& query, DocumentPredicate document_predicate) const;
+    // сопоставление разобранного запроса со словарём индекса
+    template <typename QueryType>
+    PreparedQuery ResolveQuery(const QueryType& query, std::pmr::memory_resource* resource, const QueryExpansions* expansions = nullptr) const;
+
+    // обход слов словаря с заданным префиксом (не больше max_expansion) в порядке словаря.
+    // Словарь упорядочен, поэтому слова с префиксом идут подряд начиная с lower_bound(prefix)
+    template <typename Function>
+    void ExpandPrefix(const std::string_view prefix, size_t max_expansion, Function function) const;
+
+    // обход слов словаря, похожих на word (не больше max_expansions из настроек), с их весами
+    template <typename Function>
+    void ExpandTypos(const std::string_view word, Function function) const;
+
+    // допустимое количество опечаток в слове такой длины
+    int GetMaxTypoDistance(const std::string_view word) const;
+
+    const DocumentBitmap* FindDocumentSet(const std::string_view word) const;
+
+    // удаление документа из битовых множеств его слов
+    void RemoveFromDocumentSets(int document_id);
+
+    // множество документов, содержащих минус-слова запроса: битовые множества частых
+    // слов объединяются целиком, постинги редких добавляются поштучно
+    DocumentBitmap BuildExcludedDocuments(const PreparedQuery& query, std::pmr::memory_resource* resource) const;
 
-    template <typename ExecutionPolicy, typename DocumentPredicate, typename QueryType>
-    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, QueryType& query, DocumentPredicate document_predicate) const;
+    // проверка, что подготовленный запрос сделан этим сервером для текущей ревизии индекса
+    void CheckRevision(const PreparedQuery& query) const;
 
-    void MatchedDocumentProcessing(std::vector<Document>& matched_documents) const;
+    // подсчет релевантности документов; visit_postings(postings, accumulate) решает,
+    // какие документы из постингов слова учитывать, и вызывает для них accumulate(id, tf)
+    template <typename PostingVisitor>
+    std::pmr::vector<Document> CollectDocuments(const PreparedQuery& query, PostingVisitor visit_postings, std::pmr::memory_resource* resource) const;
+
+    template <typename PostingVisitor>
+    std::pmr::vector<Document> CollectDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, PostingVisitor visit_postings, std::pmr::memory_resource* resource) const;
+
+    // подсчет релевантности в режиме min_should_match > 1: кандидаты берутся из постингов самых
+    // редких слов запроса, остальные слова проверяются у кандидата от редких к частым
+    template <typename PostingVisitor>
+    std::pmr::vector<Document> CollectMatchingDocuments(const PreparedQuery& query, const DocumentBitmap& excluded, PostingVisitor visit_postings, std::pmr::memory_resource* resource) const;
+
+    // пересечение множеств документов слов запроса, кроме skip_clauses, у которых все слова
+    // словаря частые (есть битовые множества); false, если таких слов запроса нет
+    bool IntersectClauseSets(const PreparedQuery& query, uint64_t skip_clauses, DocumentBitmap& result, std::pmr::memory_resource* resource) const;
+
+    // поиск документа в постингах от курсора, курсор только движется вперед. Кандидаты идут по
+    // возрастанию id, поэтому сначала делается несколько шагов по списку, затем спуск по дереву
+    static const double* SeekPosting(const std::map<int, double>& postings, std::map<int, double>::const_iterator& cursor, int document_id);
+
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const PreparedQuery& query, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+
+    std::pmr::vector<Document> FindAllDocuments(const PreparedQuery& query, const DocumentFilter& filter, std::pmr::memory_resource* resource) const;
+
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, const DocumentFilter& filter, std::pmr::memory_resource* resource) const;
+
+    // обход постингов слова, прошедших фильтр. Диапазон id отсекается по границам map,
+    // а если документов с допустимыми статусами мало, обход идет по их битовым множествам
+    template <typename Function>
+    void ForEachFilteredPosting(const std::map<int, double>& postings, const DocumentFilter& filter, size_t allowed_count, Function function) const;
+
+    // количество документов с допустимыми фильтром статусами
+    size_t CountAllowedDocuments(const DocumentFilter& filter) const;
+
+    // оценка работы поиска: количество постингов слов запроса
+    static uint64_t EstimateFindWork(const PreparedQuery& query);
+
+    // выбор режима по модели стоимости, выполнение function(mode) и учет решения в статистике
+    template <typename Function>
+    auto RunAdaptive(ExecutionOperation operation, uint64_t work, Function function) const;
+
+    // отбор лучших документов, результат копируется из арены в обычный вектор
+    std::vector<Document> MatchedDocumentProcessing(std::pmr::vector<Document>& matched_documents) const;
 };
 
 //============================================TEMPLATE_DEFINITION=======================================================
 
-template <typename DocumentPredicate, typename QueryType>
-std::vector<Document> SearchServer::FindAllDocuments(const QueryType& query, DocumentPredicate document_predicate) const
+template <typename PostingVisitor>
+std::pmr::vector<Document> SearchServer::CollectDocuments(const PreparedQuery& query, PostingVisitor visit_postings, std::pmr::memory_resource* resource) const
 {
-    std::map<int, double> doc_to_relevance_backet;
-    for (const std::string_view& word : query.plus_words)
-    {
-        if (word_to_document_freqs_.count(word))
-        {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
-            {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating))
-                {
-                    doc_to_relevance_backet[document_id] += term_freq * inverse_document_freq;
-                }
-            }
-        }
+    CheckRevision(query);
+    // документы с минус-словами отсекаются до подсчета релевантности
+    const DocumentBitmap excluded = BuildExcludedDocuments(query, resource);
+    if (query.min_should_match > 1) {
+        return CollectMatchingDocuments(query, excluded, visit_postings, resource);
     }
-
-    for (const std::string_view& word : query.minus_words)
+    std::pmr::map<int, double> doc_to_relevance_backet(resource);
+    size_t visited = 0;
+    for (const PreparedQuery::Term& term : query.plus_terms)
     {
-        if (word_to_document_freqs_.count(word))
-        {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word))
-            {
-                doc_to_relevance_backet.erase(document_id);
+        query.cancellation.ThrowIfCancelled();
+        visit_postings(*term.documents, [&](int document_id, double term_freq) {
+            if (++visited % CANCELLATION_CHECK_INTERVAL == 0) {
+                query.cancellation.ThrowIfCancelled();
             }
-        }
-
+            if (!excluded.Contains(document_id)) {
+                doc_to_relevance_backet[document_id] += term_freq * term.inverse_document_freq;
+            }
+            });
     }
 
-    std::vector<Document> matched_documents;
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(doc_to_relevance_backet.size());
     for (const auto [document_id, relevance] : doc_to_relevance_backet)
     {
         matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+            { document_id, relevance, rating_column_[GetDocumentSlot(document_id)] });
     }
     return matched_documents;
 }
 
-template <typename ExecutionPolicy, typename DocumentPredicate, typename QueryType>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, QueryType& query, DocumentPredicate document_predicate) const {
-
-    if (std::is_same_v <ExecutionPolicy, std::execution::sequenced_policy>) {
-        return FindAllDocuments(query, document_predicate);
+template <typename PostingVisitor>
+std::pmr::vector<Document> SearchServer::CollectDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, PostingVisitor visit_postings, std::pmr::memory_resource* resource) const {
+    CheckRevision(query);
+    query.cancellation.ThrowIfCancelled();
+    const DocumentBitmap excluded = BuildExcludedDocuments(query, resource);
+    // кандидатов после пересечения мало, их проверка идет последовательно
+    if (query.min_should_match > 1) {
+        return CollectMatchingDocuments(query, excluded, visit_postings, resource);
     }
     const size_t BACKETS_COUNT = 100;
     ConcurrentMap<int, double> doc_to_relevance_backet(BACKETS_COUNT);
-    for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [&](const auto& word) {
-        if (word_to_document_freqs_.count(word))
+    // исключение из параллельного алгоритма завершило бы программу, поэтому после отмены
+    // оставшиеся постинги только пропускаются, а исключение бросается после обхода
+    std::atomic<bool> cancelled = false;
+    for_each(std::execution::par, query.plus_terms.begin(), query.plus_terms.end(), [&](const PreparedQuery::Term& term) {
+        size_t visited = 0;
+        visit_postings(*term.documents, [&](int document_id, double term_freq) {
+            if (++visited % CANCELLATION_CHECK_INTERVAL == 0 && query.cancellation.IsCancelled()) {
+                cancelled.store(true, std::memory_order_relaxed);
+            }
+            if (!cancelled.load(std::memory_order_relaxed) && !excluded.Contains(document_id)) {
+                doc_to_relevance_backet[document_id].ref_to_value += term_freq * term.inverse_document_freq;
+            }
+            });
+        });
+    if (cancelled) {
+        throw QueryCancelledError();
+    }
+    std::map<int, double> document_to_relevance = std::move(doc_to_relevance_backet.BuildOrdinaryMap());
+
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(document_to_relevance.size());
+    std::transform(document_to_relevance.begin(), document_to_relevance.end(), std::back_inserter(matched_documents), [&](const auto& data) {
+        return Document{ data.first, data.second, rating_column_[GetDocumentSlot(data.first)] };
+        });
+    return matched_documents;
+}
+
+template <typename PostingVisitor>
+std::pmr::vector<Document> SearchServer::CollectMatchingDocuments(const PreparedQuery& query, const DocumentBitmap& excluded, PostingVisitor visit_postings, std::pmr::memory_resource* resource) const
+{
+    query.cancellation.ThrowIfCancelled();
+    std::pmr::vector<Document> matched_documents(resource);
+    const size_t min_should_match = query.min_should_match;
+    if (min_should_match > query.clause_count) {
+        return matched_documents;
+    }
+    if (query.clause_count > PreparedQuery::MAX_CLAUSE_COUNT) {
+        throw std::invalid_argument("too many words in the request for minimum should match mode");
+    }
+
+    // частота слова запроса - сумма частот его слов из словаря, у отсутствующих в индексе - ноль
+    std::pmr::vector<size_t> clause_freqs(query.clause_count, 0, resource);
+    for (const PreparedQuery::Term& term : query.plus_terms) {
+        for (size_t clause = 0; clause < query.clause_count; ++clause) {
+            if (term.clauses >> clause & 1) {
+                clause_freqs[clause] += term.documents->size();
+            }
+        }
+    }
+    // документ с min_should_match словами запроса содержит хотя бы одно из
+    // clause_count - min_should_match + 1 самых редких слов
+    const size_t driver_count = query.clause_count - min_should_match + 1;
+    std::pmr::vector<size_t> clauses(query.clause_count, resource);
+    std::iota(clauses.begin(), clauses.end(), 0);
+    std::partial_sort(clauses.begin(), clauses.begin() + driver_count, clauses.end(), [&](size_t lhs, size_t rhs) {
+        return clause_freqs[lhs] < clause_freqs[rhs];
+        });
+    uint64_t driver_clauses = 0;
+    for (size_t i = 0; i < driver_count; ++i) {
+        driver_clauses |= uint64_t{ 1 } << clauses[i];
+    }
+
+    // в режиме И кандидат должен быть и во всех остальных словах запроса: частые из них
+    // отсекают кандидатов пересечением своих битовых множеств до поиска в постингах
+    DocumentBitmap required(resource);
+    const bool check_required = min_should_match == query.clause_count && IntersectClauseSets(query, driver_clauses, required, resource);
+
+    std::pmr::vector<int> candidates(resource);
+    size_t visited = 0;
+    for (const PreparedQuery::Term& term : query.plus_terms) {
+        if (term.clauses & driver_clauses) {
+            visit_postings(*term.documents, [&](int document_id, double) {
+                if (++visited % CANCELLATION_CHECK_INTERVAL == 0) {
+                    query.cancellation.ThrowIfCancelled();
+                }
+                if (!excluded.Contains(document_id) && (!check_required || required.Contains(document_id))) {
+                    candidates.push_back(document_id);
+                }
+                });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::pmr::vector<const PreparedQuery::Term*> terms(resource);
+    terms.reserve(query.plus_terms.size());
+    for (const PreparedQuery::Term& term : query.plus_terms) {
+        terms.push_back(&term);
+    }
+    std::sort(terms.begin(), terms.end(), [](const PreparedQuery::Term* lhs, const PreparedQuery::Term* rhs) {
+        return lhs->documents->size() < rhs->documents->size();
+        });
+    // rest_clauses[i] - слова запроса, которые еще могут совпасть начиная с i-го слова словаря
+    std::pmr::vector<uint64_t> rest_clauses(terms.size() + 1, 0, resource);
+    for (size_t i = terms.size(); i > 0; --i) {
+        rest_clauses[i - 1] = rest_clauses[i] | terms[i - 1]->clauses;
+    }
+    std::pmr::vector<std::map<int, double>::const_iterator> cursors(resource);
+    cursors.reserve(terms.size());
+    for (const PreparedQuery::Term* term : terms) {
+        cursors.push_back(term->documents->begin());
+    }
+
+    for (const int document_id : candidates) {
+        if (++visited % CANCELLATION_CHECK_INTERVAL == 0) {
+            query.cancellation.ThrowIfCancelled();
+        }
+        uint64_t matched_clauses = 0;
+        double relevance = 0.0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (static_cast<size_t>(__builtin_popcountll(matched_clauses | rest_clauses[i])) < min_should_match) {
+                break;
+            }
+            if (terms[i]->document_set && !terms[i]->document_set->Contains(document_id)) {
+                continue;
+            }
+            if (const double* term_freq = SeekPosting(*terms[i]->documents, cursors[i], document_id)) {
+                matched_clauses |= terms[i]->clauses;
+                relevance += *term_freq * terms[i]->inverse_document_freq;
+            }
+        }
+        if (static_cast<size_t>(__builtin_popcountll(matched_clauses)) >= min_should_match) {
+            matched_documents.push_back({ document_id, relevance, rating_column_[GetDocumentSlot(document_id)] });
+        }
+    }
+    return matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const
+{
+    return CollectDocuments(query, [&](const std::map<int, double>& postings, auto accumulate) {
+        for (const auto [document_id, term_freq] : postings)
         {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+            const uint32_t slot = GetDocumentSlot(document_id);
+            if (document_predicate(document_id, status_column_[slot], rating_column_[slot]))
             {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating))
-                {
-                    doc_to_relevance_backet[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
+                accumulate(document_id, term_freq);
             }
         }
-        });
-    std::map<int, double> document_to_relevance = std::move(doc_to_relevance_backet.BuildOrdinaryMap());
-    for_each(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [&](const auto& word) {
-        if (word_to_document_freqs_.count(word))
+        }, resource);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const PreparedQuery& query, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const {
+
+    if (std::is_same_v <ExecutionPolicy, std::execution::sequenced_policy>) {
+        return FindAllDocuments(query, document_predicate, resource);
+    }
+    return CollectDocuments(std::execution::par, query, [&](const std::map<int, double>& postings, auto accumulate) {
+        for (const auto [document_id, term_freq] : postings)
         {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+            const uint32_t slot = GetDocumentSlot(document_id);
+            if (document_predicate(document_id, status_column_[slot], rating_column_[slot]))
             {
-                document_to_relevance.erase(document_id);
+                accumulate(document_id, term_freq);
             }
         }
-        });
+        }, resource);
+}
 
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance.size());
-    std::transform(document_to_relevance.begin(), document_to_relevance.end(), std::back_inserter(matched_documents), [&](const auto& data) {
-        return Document{ data.first, data.second, documents_.at(data.first).rating };
+template <typename Function>
+void SearchServer::ExpandPrefix(const std::string_view prefix, size_t max_expansion, Function function) const
+{
+    size_t expanded = 0;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+        it != word_to_document_freqs_.end() && expanded < max_expansion && it->first.substr(0, prefix.size()) == prefix; ++it)
+    {
+        if (!it->second.empty()) {
+            function(*it);
+            ++expanded;
+        }
+    }
+}
+
+template <typename Function>
+void SearchServer::ExpandTypos(const std::string_view word, Function function) const
+{
+    const int max_distance = GetMaxTypoDistance(word);
+    if (max_distance == 0) {
+        return;
+    }
+    std::vector<std::pair<int, const std::pair<const std::string_view, std::map<int, double>>*>> matches;
+    for (const SimilarWord& similar : typo_index_->FindSimilar(word, max_distance)) {
+        const auto it = word_to_document_freqs_.find(similar.word);
+        if (!it->second.empty()) {
+            matches.emplace_back(similar.distance, &*it);
+        }
+    }
+    // ближайшие слова, при равном расстоянии - более частые, затем по порядку словаря
+    std::sort(matches.begin(), matches.end(), [](const auto& lhs, const auto& rhs) {
+        if (lhs.first != rhs.first) {
+            return lhs.first < rhs.first;
+        }
+        if (lhs.second->second.size() != rhs.second->second.size()) {
+            return lhs.second->second.size() > rhs.second->second.size();
+        }
+        return lhs.second->first < rhs.second->first;
         });
-    return matched_documents;
+    if (matches.size() > typo_config_.max_expansions) {
+        matches.resize(typo_config_.max_expansions);
+    }
+    for (const auto& [distance, entry] : matches) {
+        function(*entry, std::pow(typo_config_.typo_penalty, distance));
+    }
+}
+
+template <typename Function>
+void SearchServer::ForEachFilteredPosting(const std::map<int, double>& postings, const DocumentFilter& filter, size_t allowed_count, Function function) const
+{
+    const bool check_rating = filter.min_rating != INT_MIN || filter.max_rating != INT_MAX;
+    // поиск документа в постингах стоит O(log P), обход постингов - O(P)
+    const double probe_cost = std::log2(postings.size() + 1.0);
+    if (allowed_count * probe_cost < postings.size()) {
+        for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            if (!filter.HasStatus(static_cast<DocumentStatus>(status))) {
+                continue;
+            }
+            status_documents_[status].ForEachInRange(filter.min_id, filter.max_id, [&](int document_id) {
+                const auto it = postings.find(document_id);
+                if (it == postings.end()) {
+                    return;
+                }
+                if (check_rating) {
+                    const int rating = rating_column_[GetDocumentSlot(document_id)];
+                    if (rating < filter.min_rating || filter.max_rating < rating) {
+                        return;
+                    }
+                }
+                function(document_id, it->second);
+                });
+        }
+        return;
+    }
+    const bool check_status = !filter.HasAllStatuses();
+    const auto last = postings.upper_bound(filter.max_id);
+    for (auto it = postings.lower_bound(filter.min_id); it != last; ++it) {
+        const int document_id = it->first;
+        if (check_status || check_rating) {
+            const uint32_t slot = GetDocumentSlot(document_id);
+            if (check_status && !filter.HasStatus(status_column_[slot])) {
+                continue;
+            }
+            if (check_rating && (rating_column_[slot] < filter.min_rating || filter.max_rating < rating_column_[slot])) {
+                continue;
+            }
+        }
+        function(document_id, it->second);
+    }
 }
 
 //=============================================FIND_TOP_DOCUMENTS==============================================================
@@ -283,10 +866,8 @@ std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& poli
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
 {
-    Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    MatchedDocumentProcessing(matched_documents);
-    return matched_documents;
+    QueryArena::Scope arena;
+    return FindTopDocuments(PrepareQuery(raw_query, arena.Resource()), document_predicate);
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
@@ -295,10 +876,60 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& poli
     if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
         return FindTopDocuments(raw_query, document_predicate);
     }
+    QueryArena::Scope arena;
+    return FindTopDocuments(std::execution::par, PrepareQuery(std::execution::par, raw_query, arena.Resource()), document_predicate);
+}
 
-    QueryParallel query = ParseQuery(std::execution::par, raw_query);
-    auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
-    MatchedDocumentProcessing(matched_documents);
-    return matched_documents;
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const
+{
+    QueryArena::Scope arena;
+    auto matched_documents = FindAllDocuments(query, document_predicate, arena.Resource());
+    return MatchedDocumentProcessing(matched_documents);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const PreparedQuery& query, DocumentPredicate document_predicate) const
+{
+    if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        return FindTopDocuments(query, document_predicate);
+    }
+    QueryArena::Scope arena;
+    auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate, arena.Resource());
+    return MatchedDocumentProcessing(matched_documents);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    QueryArena::Scope arena;
+    return FindTopDocuments(policy, PrepareQuery(raw_query, arena.Resource()), document_predicate);
 }
 
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const AdaptivePolicy&, const PreparedQuery& query, DocumentPredicate document_predicate) const
+{
+    return RunAdaptive(ExecutionOperation::FIND_TOP_DOCUMENTS, EstimateFindWork(query), [&](ExecutionMode mode) {
+        return mode == ExecutionMode::PARALLEL ? FindTopDocuments(std::execution::par, query, document_predicate) : FindTopDocuments(query, document_predicate);
+        });
+}
+
+template <typename Function>
+auto SearchServer::RunAdaptive(ExecutionOperation operation, uint64_t work, Function function) const
+{
+    const ExecutionMode mode = cost_model_.Choose(operation, work);
+    const auto start = std::chrono::steady_clock::now();
+    auto record = [&] {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        execution_stats_.Record(operation, mode, work, elapsed.count());
+    };
+    if constexpr (std::is_void_v<decltype(function(mode))>) {
+        function(mode);
+        record();
+    }
+    else {
+        auto result = function(mode);
+        record();
+        return result;
+    }
+}
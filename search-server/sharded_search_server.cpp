@@ -0,0 +1,141 @@
+#include <cmath>
+#include <map>
+
+#include "sharded_search_server.h"
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, std::string_view stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text))
+{
+}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const std::string& stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text))
+{
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    if (document_id < 0)
+        throw std::invalid_argument("ID cannot be negative");
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::UpdateDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    if (document_id < 0) {
+        throw std::out_of_range("id not exists");
+    }
+    shards_[GetShardIndex(document_id)].UpdateDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::UpdateDocument(int document_id, DocumentStatus status, const std::vector<int>& ratings)
+{
+    if (document_id < 0) {
+        throw std::out_of_range("id not exists");
+    }
+    shards_[GetShardIndex(document_id)].UpdateDocument(document_id, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    if (document_id >= 0) {
+        shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+    }
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocuments(raw_query, DocumentFilter{ status });
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const
+{
+    return ScatterGather(raw_query, [&](const SearchServer& shard, const PreparedQuery& query) {
+        return shard.FindTopDocuments(query, filter);
+        });
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
+    if (document_id < 0) {
+        throw std::out_of_range("id not exists");
+    }
+    const SearchServer& shard = shards_[GetShardIndex(document_id)];
+    return shard.MatchDocument(shard.PrepareQuery(raw_query, SearchServer::ExpandQuery(raw_query, shards_)), document_id);
+}
+
+void ShardedSearchServer::EnableTypoTolerance(const TypoToleranceConfig& config)
+{
+    for (SearchServer& shard : shards_) {
+        shard.EnableTypoTolerance(config);
+    }
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+    int count = 0;
+    for (const SearchServer& shard : shards_) {
+        count += shard.GetDocumentCount();
+    }
+    return count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const
+{
+    return shards_.at(index);
+}
+
+void ShardedSearchServer::ReplaceShard(size_t index, SearchServer shard)
+{
+    if (index >= shards_.size()) {
+        throw std::out_of_range("shard index out of range");
+    }
+    for (const int document_id : shard) {
+        if (GetShardIndex(document_id) != index) {
+            throw std::invalid_argument("document belongs to another shard");
+        }
+    }
+    shards_[index] = std::move(shard);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const
+{
+    return static_cast<size_t>(document_id) % shards_.size();
+}
+
+std::vector<PreparedQuery> ShardedSearchServer::PrepareQueries(const std::string_view raw_query) const
+{
+    // префиксы и опечатки раскрываются один раз по словарям всех шардов, иначе шарды
+    // искали бы разные слова: первые по своему словарю и частые в своей части коллекции
+    const SearchServer::QueryExpansions expansions = SearchServer::ExpandQuery(raw_query, shards_);
+    std::vector<PreparedQuery> queries;
+    queries.reserve(shards_.size());
+    for (const SearchServer& shard : shards_) {
+        queries.push_back(shard.PrepareQuery(raw_query, expansions));
+    }
+
+    // документная частота слова во всей коллекции - сумма по шардам
+    std::map<std::string_view, size_t> document_freqs;
+    for (const PreparedQuery& query : queries) {
+        for (const PreparedQuery::Term& term : query.plus_terms) {
+            document_freqs[term.word] += term.documents->size();
+        }
+    }
+    const double document_count = GetDocumentCount();
+    for (PreparedQuery& query : queries) {
+        for (PreparedQuery::Term& term : query.plus_terms) {
+            term.inverse_document_freq = std::log(document_count / document_freqs.at(term.word)) * term.weight;
+        }
+    }
+    return queries;
+}
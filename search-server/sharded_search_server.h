@@ -0,0 +1,106 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "search_server.h"
+#include "document.h"
+#include "document_filter.h"
+
+// поисковый сервер, разбитый на шарды по id документа (id % количество шардов).
+// Запрос рассылается во все шарды параллельно, префиксы и опечатки раскрываются и IDF считается
+// по всей коллекции, а лучшие документы шардов объединяются в общем порядке выдачи
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer& stop_words);
+
+    ShardedSearchServer(size_t shard_count, std::string_view stop_words_text);
+
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words_text);
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void UpdateDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void UpdateDocument(int document_id, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // поиск с опечатками во всех шардах, см. SearchServer::EnableTypoTolerance
+    void EnableTypoTolerance(const TypoToleranceConfig& config = {});
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+    const SearchServer& GetShard(size_t index) const;
+
+    // замена шарда заново построенным, все документы нового шарда должны относиться к нему
+    void ReplaceShard(size_t index, SearchServer shard);
+
+private:
+    std::vector<SearchServer> shards_;
+
+    size_t GetShardIndex(int document_id) const;
+
+    // подготовка запроса для каждого шарда с IDF, посчитанным по всем шардам
+    std::vector<PreparedQuery> PrepareQueries(const std::string_view raw_query) const;
+
+    // рассылка запроса по шардам и объединение их результатов
+    template <typename ShardSearch>
+    std::vector<Document> ScatterGather(const std::string_view raw_query, ShardSearch shard_search) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringContainer& stop_words)
+{
+    if (shard_count == 0) {
+        throw std::invalid_argument("shard count must be positive");
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    return ScatterGather(raw_query, [&](const SearchServer& shard, const PreparedQuery& query) {
+        return shard.FindTopDocuments(query, document_predicate);
+        });
+}
+
+template <typename ShardSearch>
+std::vector<Document> ShardedSearchServer::ScatterGather(const std::string_view raw_query, ShardSearch shard_search) const
+{
+    const std::vector<PreparedQuery> queries = PrepareQueries(raw_query);
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    std::transform(std::execution::par, shards_.begin(), shards_.end(), queries.begin(), shard_results.begin(),
+        [&](const SearchServer& shard, const PreparedQuery& query) {
+            return shard_search(shard, query);
+        });
+
+    // каждый шард вернул свои лучшие документы, общий топ находится среди них
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_results) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    const size_t result_size = std::min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::partial_sort(matched_documents.begin(), matched_documents.begin() + result_size, matched_documents.end(), SearchServer::IsMoreRelevant);
+    matched_documents.resize(result_size);
+    return matched_documents;
+}
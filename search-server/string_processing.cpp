@@ -5,8 +5,8 @@ bool IsInvalidCharacter(const char character)
     return (character >= 0 && character < 32);
 }
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text) {
-    std::vector<std::string_view> words;
+template <typename Container>
+static void SplitIntoWordsTo(std::string_view text, Container& words) {
     size_t pos = text.find_first_not_of(' ');
     while (pos < text.size()) {
         text.remove_prefix(pos);
@@ -18,5 +18,56 @@ std::vector<std::string_view> SplitIntoWords(std::string_view text) {
         words.push_back(text.substr(0, pos));
         pos = text.find_first_not_of(' ', pos);
     }
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> words;
+    SplitIntoWordsTo(text, words);
     return words;
-}
\ No newline at end of file
+}
+
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> words(resource);
+    SplitIntoWordsTo(text, words);
+    return words;
+}
+
+WordDictionary::WordDictionary() : words_(std::make_shared<Storage>()) {
+}
+
+WordDictionary::WordDictionary(const WordDictionary& other) : words_(std::make_shared<Storage>()), retained_(other.retained_) {
+    retained_.push_back(other.words_);
+}
+
+WordDictionary& WordDictionary::operator=(const WordDictionary& other) {
+    if (this != &other) {
+        std::vector<std::shared_ptr<const Storage>> retained = other.retained_;
+        retained.push_back(other.words_);
+        retained_ = std::move(retained);
+        words_ = std::make_shared<Storage>();
+    }
+    return *this;
+}
+
+std::pair<std::string_view, bool> WordDictionary::Insert(std::string_view word) {
+    for (const auto& storage : retained_) {
+        const auto it = storage->find(word);
+        if (it != storage->end()) {
+            return { *it, false };
+        }
+    }
+    const auto [it, inserted] = words_->emplace(word);
+    return { *it, inserted };
+}
+
+bool WordDictionary::Contains(std::string_view word) const {
+    if (words_->count(word)) {
+        return true;
+    }
+    for (const auto& storage : retained_) {
+        if (storage->count(word)) {
+            return true;
+        }
+    }
+    return false;
+}
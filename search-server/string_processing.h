@@ -5,16 +5,40 @@
 #include <string_view>
 #include <vector>
 #include <set>
+#include <memory>
+#include <memory_resource>
 
-static std::set<std::string> all_words_;
+// словарь сервера: строки слов, на которые ссылаются string_view его индекса.
+// Копия словаря складывает новые слова в собственное хранилище и продлевает жизнь
+// хранилищ оригинала, поэтому ссылки скопированного индекса остаются действительными
+class WordDictionary {
+public:
+    WordDictionary();
+    WordDictionary(const WordDictionary& other);
+    WordDictionary& operator=(const WordDictionary& other);
+
+    // строка словаря, равная word, и признак того, что слово скопировано только что
+    std::pair<std::string_view, bool> Insert(std::string_view word);
+    bool Contains(std::string_view word) const;
+
+private:
+    using Storage = std::set<std::string, std::less<>>;
+
+    std::shared_ptr<Storage> words_;
+    // хранилища словарей, копией которых является этот
+    std::vector<std::shared_ptr<const Storage>> retained_;
+};
 
 bool IsInvalidCharacter(const char character);
 // разбиение строки на вектор слов
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// разбиение строки на вектор слов, память под вектор берется из переданного ресурса
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource);
+
 // структура, хранящая id, релевантность и рейтинг документа
 template <typename StringContainer>
-std::set<std::string_view> MakeUniqueNonEmptyStrings(const StringContainer& strings)
+std::set<std::string_view> MakeUniqueNonEmptyStrings(const StringContainer& strings, WordDictionary& dictionary)
 {
     std::set<std::string_view> non_empty_strings;
     for (std::string_view str : strings)
@@ -26,8 +50,7 @@ std::set<std::string_view> MakeUniqueNonEmptyStrings(const StringContainer& stri
                     throw std::invalid_argument("unreadable characters in the text");
                 }
             }
-            const auto [new_word, inserted] = all_words_.insert(static_cast<std::string>(str));
-            non_empty_strings.insert(*new_word);
+            non_empty_strings.insert(dictionary.Insert(str).first);
         }
     }
     return non_empty_strings;
@@ -0,0 +1,66 @@
+// проверка, что поиск берет временную память из арены запроса: после прогрева куча
+// нужна только под возвращаемый вектор результата.
+// Сборка: этот файл и все .cpp каталога search-server, кроме main.cpp
+#include "../search_server.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+// счетчик выделений глобальной кучи в текущем потоке
+thread_local size_t heap_allocation_count = 0;
+void* operator new(size_t size) {
+    ++heap_allocation_count;
+    if (void* pointer = malloc(size)) {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+string GenerateText(mt19937& generator, int word_count) {
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += "word"s + to_string(uniform_int_distribution(0, 999)(generator));
+    }
+    return text;
+}
+int main() {
+    mt19937 generator;
+    SearchServer search_server("word0"s);
+    for (int i = 0; i < 2'000; ++i) {
+        search_server.AddDocument(i, GenerateText(generator, 50), DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    vector<string> queries;
+    for (int i = 0; i < 50; ++i) {
+        queries.push_back(GenerateText(generator, 20) + " -word"s + to_string(i));
+    }
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(query);
+        search_server.MatchDocument(query, 0);
+    }
+    size_t max_find_allocations = 0;
+    size_t max_match_allocations = 0;
+    for (const string& query : queries) {
+        size_t allocations = heap_allocation_count;
+        search_server.FindTopDocuments(query);
+        max_find_allocations = max(max_find_allocations, heap_allocation_count - allocations);
+        allocations = heap_allocation_count;
+        search_server.MatchDocument(query, 0);
+        max_match_allocations = max(max_match_allocations, heap_allocation_count - allocations);
+    }
+    cout << "allocations per query: find = "s << max_find_allocations << ", match = "s << max_match_allocations << endl;
+    if (max_find_allocations > 1 || max_match_allocations > 1) {
+        cerr << "query path allocates from the heap"s << endl;
+        return EXIT_FAILURE;
+    }
+}
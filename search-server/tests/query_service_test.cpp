@@ -0,0 +1,41 @@
+// нагрузочная проверка QueryService на локальном порту: все команды конвейера
+// получают успешные ответы. Сборка: этот файл и все .cpp каталога search-server, кроме main.cpp
+#include "../search_server.h"
+#include "../query_service.h"
+#include "../load_generator.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+string GenerateText(mt19937& generator, int word_count) {
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += "word"s + to_string(uniform_int_distribution(0, 999)(generator));
+    }
+    return text;
+}
+int main() {
+    mt19937 generator;
+    SearchServer search_server("word0"s);
+    for (int i = 0; i < 2'000; ++i) {
+        search_server.AddDocument(i, GenerateText(generator, 50), DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    vector<string> requests;
+    for (int i = 0; i < 200; ++i) {
+        requests.push_back("FIND "s + GenerateText(generator, 20));
+    }
+    QueryService service(search_server);
+    service.Start();
+    const LoadReport report = RunLoadGenerator(service.GetPort(), requests, 4, 8);
+    service.Stop();
+    cout << "service: "s << report << endl;
+    if (report.request_count != requests.size() || report.error_count != 0) {
+        cerr << "query service lost or failed requests"s << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,50 @@
+// проверка групповой фиксации журнала: одна запись без Sync становится надежной
+// примерно через commit_interval. Журнал пишется во временный файл и удаляется.
+// Сборка: этот файл и все .cpp каталога search-server, кроме main.cpp
+#include "../search_server.h"
+#include "../write_ahead_log.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+// уникальный временный файл, созданный mkstemp
+string MakeTemporaryFile() {
+    const char* directory = getenv("TMPDIR");
+    string path = (directory && *directory ? string(directory) : "/tmp"s) + "/wal_test_XXXXXX"s;
+    vector<char> buffer(path.begin(), path.end());
+    buffer.push_back('\0');
+    const int fd = mkstemp(buffer.data());
+    if (fd < 0) {
+        throw runtime_error("cannot create temporary file"s);
+    }
+    close(fd);
+    return buffer.data();
+}
+int main() {
+    const string path = MakeTemporaryFile();
+    bool committed_in_time = false;
+    bool single_commit = false;
+    {
+        WriteAheadLogConfig config;
+        config.commit_interval = chrono::milliseconds(5);
+        WriteAheadLog log(path, config);
+        SearchServer search_server;
+        search_server.SetWriteAheadLog(&log);
+        const auto start = chrono::steady_clock::now();
+        search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+        log.WaitDurable(1);
+        const auto elapsed = chrono::steady_clock::now() - start;
+        single_commit = log.GetDurableSequence() == 1 && log.GetCommitCount() == 1;
+        committed_in_time = elapsed < config.commit_interval * 20;
+        cout << "wal commit: "s << chrono::duration_cast<chrono::microseconds>(elapsed).count() << " us"s << endl;
+    }
+    unlink(path.c_str());
+    if (!single_commit || !committed_in_time) {
+        cerr << "write-ahead log did not commit a single record in time"s << endl;
+        return EXIT_FAILURE;
+    }
+}
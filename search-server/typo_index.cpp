@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "typo_index.h"
+#include "memory_stats.h"
+
+EditDistanceMatcher::EditDistanceMatcher(std::string_view pattern) : pattern_(pattern) {
+    if (pattern.size() > MAX_PATTERN_SIZE) {
+        throw std::invalid_argument("pattern is too long for edit distance matching");
+    }
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        positions_[static_cast<uint8_t>(pattern[i])] |= uint64_t{ 1 } << i;
+    }
+}
+
+int EditDistanceMatcher::Distance(std::string_view text, int max_distance) const {
+    const int length_difference = static_cast<int>(text.size()) - static_cast<int>(pattern_.size());
+    if (std::abs(length_difference) > max_distance) {
+        return max_distance + 1;
+    }
+    if (pattern_.empty()) {
+        return static_cast<int>(text.size());
+    }
+    // Pv / Mv - вертикальные приращения +1 / -1 столбца динамики, score - значение последней строки
+    uint64_t positive_vertical = ~uint64_t{ 0 };
+    uint64_t negative_vertical = 0;
+    const uint64_t last_bit = uint64_t{ 1 } << (pattern_.size() - 1);
+    int score = static_cast<int>(pattern_.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        const uint64_t equal = positions_[static_cast<uint8_t>(text[i])];
+        const uint64_t vertical = equal | negative_vertical;
+        const uint64_t horizontal = (((equal & positive_vertical) + positive_vertical) ^ positive_vertical) | equal;
+        uint64_t positive_horizontal = negative_vertical | ~(horizontal | positive_vertical);
+        uint64_t negative_horizontal = positive_vertical & horizontal;
+        if (positive_horizontal & last_bit) {
+            ++score;
+        }
+        else if (negative_horizontal & last_bit) {
+            --score;
+        }
+        // каждый следующий символ текста уменьшает расстояние не больше чем на 1
+        if (score - static_cast<int>(text.size() - i - 1) > max_distance) {
+            return max_distance + 1;
+        }
+        // верхняя строка динамики - расстояние до пустого образца, растет на 1 с каждым символом
+        positive_horizontal = positive_horizontal << 1 | 1;
+        negative_horizontal <<= 1;
+        positive_vertical = negative_horizontal | ~(vertical | positive_horizontal);
+        negative_vertical = positive_horizontal & vertical;
+    }
+    return std::min(score, max_distance + 1);
+}
+
+void TrigramIndex::Add(std::string_view word) {
+    if (words_.size() >= UINT32_MAX) {
+        throw std::length_error("too many words in trigram index");
+    }
+    const uint32_t word_index = static_cast<uint32_t>(words_.size());
+    words_.push_back(word);
+    std::vector<uint32_t> trigrams;
+    GetTrigrams(word, trigrams);
+    for (const uint32_t trigram : trigrams) {
+        trigram_to_words_[GetListKey(trigram, word.size())].push_back(word_index);
+    }
+}
+
+std::vector<SimilarWord> TrigramIndex::FindSimilar(std::string_view word, int max_distance) const {
+    std::vector<SimilarWord> result;
+    if (word.size() > EditDistanceMatcher::MAX_PATTERN_SIZE) {
+        return result;
+    }
+    std::vector<uint32_t> trigrams;
+    GetTrigrams(word, trigrams);
+    max_distance = std::min(max_distance, (static_cast<int>(trigrams.size()) - 1) / 3);
+    if (max_distance <= 0) {
+        return result;
+    }
+
+    // ScanCount: счетчик общих триграмм для каждого слова из списков триграмм запроса.
+    // Массив счетчиков переиспользуется потоком, после подсчета счетчики обнуляются
+    // повторным проходом по тем же спискам
+    thread_local std::vector<uint8_t> counts;
+    if (counts.size() < words_.size()) {
+        counts.resize(words_.size());
+    }
+    // длины слов на расстоянии не больше max_distance отличаются не больше чем на max_distance
+    std::vector<const std::vector<uint32_t>*> lists;
+    const size_t min_length = word.size() > static_cast<size_t>(max_distance) ? word.size() - max_distance : 0;
+    for (size_t length = min_length; length <= word.size() + max_distance; ++length) {
+        for (const uint32_t trigram : trigrams) {
+            const auto it = trigram_to_words_.find(GetListKey(trigram, length));
+            if (it != trigram_to_words_.end()) {
+                lists.push_back(&it->second);
+            }
+        }
+    }
+    const size_t min_common = trigrams.size() - 3 * static_cast<size_t>(max_distance);
+    std::vector<uint32_t> candidates;
+    for (const std::vector<uint32_t>* list : lists) {
+        for (const uint32_t word_index : *list) {
+            if (++counts[word_index] == min_common) {
+                candidates.push_back(word_index);
+            }
+        }
+    }
+    for (const std::vector<uint32_t>* list : lists) {
+        for (const uint32_t word_index : *list) {
+            counts[word_index] = 0;
+        }
+    }
+
+    const EditDistanceMatcher matcher(word);
+    for (const uint32_t candidate : candidates) {
+        const std::string_view candidate_word = words_[candidate];
+        const int distance = matcher.Distance(candidate_word, max_distance);
+        if (distance > 0 && distance <= max_distance) {
+            result.push_back({ candidate_word, distance });
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const SimilarWord& lhs, const SimilarWord& rhs) {
+        return std::pair(lhs.distance, lhs.word) < std::pair(rhs.distance, rhs.word);
+        });
+    return result;
+}
+
+size_t TrigramIndex::GetWordCount() const {
+    return words_.size();
+}
+
+size_t TrigramIndex::GetAllocatedBytes() const {
+    size_t bytes = words_.capacity() * sizeof(std::string_view) + trigram_to_words_.bucket_count() * sizeof(void*);
+    // узел unordered_map: указатель на следующий, значение и сохраненный хеш
+    const size_t node_size = GetAllocatedBlockSize(sizeof(void*) + sizeof(std::pair<const uint32_t, std::vector<uint32_t>>) + sizeof(size_t));
+    for (const auto& [_, word_indexes] : trigram_to_words_) {
+        bytes += node_size + GetAllocatedBlockSize(word_indexes.capacity() * sizeof(uint32_t));
+    }
+    return bytes;
+}
+
+size_t TrigramIndex::GetAllocatedBytesAfterAdd(const std::pmr::vector<std::string_view>& words) const {
+    if (words.empty()) {
+        return GetAllocatedBytes();
+    }
+    std::pmr::vector<uint32_t> keys(words.get_allocator().resource());
+    std::vector<uint32_t> trigrams;
+    for (const std::string_view word : words) {
+        GetTrigrams(word, trigrams);
+        for (const uint32_t trigram : trigrams) {
+            keys.push_back(GetListKey(trigram, word.size()));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    const size_t node_size = GetAllocatedBlockSize(sizeof(void*) + sizeof(std::pair<const uint32_t, std::vector<uint32_t>>) + sizeof(size_t));
+    size_t bytes = GetAllocatedBytes() + (GrowCapacity(words_.size(), words_.capacity(), words.size()) - words_.capacity()) * sizeof(std::string_view);
+    size_t list_count = trigram_to_words_.size();
+    for (size_t begin = 0, end = 0; begin < keys.size(); begin = end) {
+        for (end = begin; end < keys.size() && keys[end] == keys[begin]; ++end) {
+        }
+        const auto it = trigram_to_words_.find(keys[begin]);
+        if (it == trigram_to_words_.end()) {
+            ++list_count;
+            bytes += node_size + GetAllocatedBlockSize(GrowCapacity(0, 0, end - begin) * sizeof(uint32_t));
+        }
+        else {
+            const std::vector<uint32_t>& list = it->second;
+            bytes += GetAllocatedBlockSize(GrowCapacity(list.size(), list.capacity(), end - begin) * sizeof(uint32_t)) - GetAllocatedBlockSize(list.capacity() * sizeof(uint32_t));
+        }
+    }
+    // таблица растет примерно вдвое, до следующего простого числа корзин
+    const size_t bucket_count = trigram_to_words_.bucket_count();
+    if (list_count > bucket_count * trigram_to_words_.max_load_factor()) {
+        const size_t new_bucket_count = std::max<size_t>(bucket_count * 2, list_count / trigram_to_words_.max_load_factor());
+        bytes += (new_bucket_count + new_bucket_count / 8 + 16 - bucket_count) * sizeof(void*);
+    }
+    return bytes;
+}
+
+size_t TrigramIndex::GrowCapacity(size_t size, size_t capacity, size_t count) {
+    for (; count > 0; --count, ++size) {
+        if (size == capacity) {
+            capacity = size + std::max<size_t>(size, 1);
+        }
+    }
+    return capacity;
+}
+
+uint32_t TrigramIndex::GetListKey(uint32_t trigram, size_t word_length) {
+    return trigram << 8 | static_cast<uint32_t>(std::min<size_t>(word_length, 255));
+}
+
+void TrigramIndex::GetTrigrams(std::string_view word, std::vector<uint32_t>& trigrams) {
+    trigrams.clear();
+    // нулевой байт не встречается в словах и обозначает границу слова
+    auto at = [&](size_t padded_index) -> uint32_t {
+        return padded_index == 0 || padded_index > word.size() ? 0 : static_cast<uint8_t>(word[padded_index - 1]);
+    };
+    for (size_t i = 0; i < word.size(); ++i) {
+        trigrams.push_back(at(i) << 16 | at(i + 1) << 8 | at(i + 2));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// настройки поиска с опечатками. Слово запроса "word~" раскрывается в похожие слова словаря,
+// слово, которого нет в словаре, - при correct_missing_words. Похожее слово с d правками
+// получает вес typo_penalty^d, на который умножается его IDF
+struct TypoToleranceConfig {
+    bool correct_missing_words = true;
+    // длина слова, начиная с которой допускается одна и две правки
+    size_t min_length_one_typo = 4;
+    size_t min_length_two_typos = 8;
+    // похожих слов на одно слово запроса не больше max_expansions: ближайшие, затем самые частые
+    size_t max_expansions = 8;
+    double typo_penalty = 0.5;
+};
+
+// расстояние редактирования (Левенштейна) от слова-образца до других слов, битово-параллельный
+// алгоритм Майерса: столбец динамики хранится битами одного 64-битного слова, поэтому
+// сравнение со словом длины n стоит O(n) операций. Образец - не длиннее MAX_PATTERN_SIZE
+class EditDistanceMatcher {
+public:
+    static const size_t MAX_PATTERN_SIZE = 64;
+
+    explicit EditDistanceMatcher(std::string_view pattern);
+
+    // расстояние до text, если оно не больше max_distance, иначе max_distance + 1
+    int Distance(std::string_view text, int max_distance) const;
+
+private:
+    std::string_view pattern_;
+    // биты позиций образца, где стоит символ
+    std::array<uint64_t, 256> positions_{};
+};
+
+// похожее слово словаря и расстояние до него
+struct SimilarWord {
+    std::string_view word;
+    int distance;
+};
+
+// индекс триграмм словаря для поиска слов с опечатками. Слово дополняется границами
+// ("\0word\0") и раскладывается на триграммы, для каждой триграммы и длины слова хранится
+// список номеров слов, поэтому поиск просматривает только слова подходящей длины. Правка одного символа меняет не больше трех триграмм, поэтому слово на расстоянии
+// не больше k содержит хотя бы t = |триграммы запроса| - 3k его триграмм. Общие триграммы
+// считаются проходом по спискам триграмм запроса, слова, набравшие t, проверяются
+// EditDistanceMatcher. Слова только добавляются: словарь сервера не уменьшается
+class TrigramIndex {
+public:
+    // слово должно жить дольше индекса (строка словаря сервера)
+    void Add(std::string_view word);
+
+    // слова на расстоянии от 1 до max_distance; max_distance уменьшается, пока фильтр по
+    // триграммам остается применимым (t >= 1). Порядок - по расстоянию, затем по слову
+    std::vector<SimilarWord> FindSimilar(std::string_view word, int max_distance) const;
+
+    size_t GetWordCount() const;
+    size_t GetAllocatedBytes() const;
+    // оценка сверху объема памяти после добавления новых слов words
+    size_t GetAllocatedBytesAfterAdd(const std::pmr::vector<std::string_view>& words) const;
+
+private:
+    std::vector<std::string_view> words_;
+    // ключ - триграмма (24 бита) и длина слова (8 бит)
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigram_to_words_;
+
+    static uint32_t GetListKey(uint32_t trigram, size_t word_length);
+
+    // емкость вектора после count вставок в конец
+    static size_t GrowCapacity(size_t size, size_t capacity, size_t count);
+
+    // различные триграммы слова с границами
+    static void GetTrigrams(std::string_view word, std::vector<uint32_t>& trigrams);
+};
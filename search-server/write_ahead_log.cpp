@@ -0,0 +1,345 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "write_ahead_log.h"
+#include "corpus_loader.h"
+#include "mapped_file.h"
+#include "search_server.h"
+
+namespace {
+
+enum class RecordType : uint8_t {
+    ADD = 1,
+    REMOVE = 2,
+    // новый текст, статус и рейтинги существующего документа
+    UPDATE = 3,
+    // только статус и рейтинги
+    UPDATE_ATTRIBUTES = 4,
+};
+
+// заголовок записи: длина данных и их CRC32
+const size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+uint32_t ComputeCrc32(std::string_view data) {
+    static const std::array<uint32_t, 256> TABLE = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (const char c : data) {
+        crc = TABLE[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename Value>
+void Put(std::string& out, Value value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// чтение значения из данных записи; false, если данных не хватает
+template <typename Value>
+bool Get(std::string_view& data, Value& value) {
+    if (data.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data.data(), sizeof(value));
+    data.remove_prefix(sizeof(value));
+    return true;
+}
+
+void WriteAll(int fd, std::string_view data, const std::string& path) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "cannot write " + path);
+        }
+        data.remove_prefix(written);
+    }
+}
+
+// статус и рейтинги из данных записи
+bool GetAttributes(std::string_view& payload, DocumentStatus& status, std::vector<int>& ratings) {
+    uint8_t status_value = 0;
+    uint32_t rating_count = 0;
+    if (!Get(payload, status_value) || status_value >= DOCUMENT_STATUS_COUNT
+        || !Get(payload, rating_count) || payload.size() / sizeof(int32_t) < rating_count) {
+        return false;
+    }
+    status = static_cast<DocumentStatus>(status_value);
+    ratings.resize(rating_count);
+    for (int& rating : ratings) {
+        int32_t value = 0;
+        Get(payload, value);
+        rating = value;
+    }
+    return true;
+}
+
+// применение одной записи; false, если данные записи повреждены
+bool ApplyRecord(SearchServer& search_server, std::string_view payload, std::vector<int>& ratings) {
+    uint8_t type = 0;
+    int32_t document_id = 0;
+    if (!Get(payload, type) || !Get(payload, document_id)) {
+        return false;
+    }
+    if (type == static_cast<uint8_t>(RecordType::REMOVE)) {
+        search_server.RemoveDocument(document_id);
+        return payload.empty();
+    }
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    if (!GetAttributes(payload, status, ratings)) {
+        return false;
+    }
+    // изменение могло попасть в снимок, который сделан позже записи
+    const bool exists = search_server.HasDocument(document_id);
+    switch (static_cast<RecordType>(type)) {
+    case RecordType::ADD:
+        if (!exists) {
+            search_server.AddDocument(document_id, payload, status, ratings);
+        }
+        return true;
+    case RecordType::UPDATE:
+        if (exists) {
+            search_server.UpdateDocument(document_id, payload, status, ratings);
+        }
+        else {
+            search_server.AddDocument(document_id, payload, status, ratings);
+        }
+        return true;
+    case RecordType::UPDATE_ATTRIBUTES:
+        if (exists) {
+            search_server.UpdateDocument(document_id, status, ratings);
+        }
+        return payload.empty();
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, WriteAheadLogConfig config)
+    : path_(path), config_(config) {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+    }
+    committer_ = std::thread([this] { RunCommitter(); });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    commit_requested_.notify_one();
+    committer_.join();
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAdd(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    return AppendDocument(static_cast<uint8_t>(RecordType::ADD), document_id, document, status, ratings);
+}
+
+uint64_t WriteAheadLog::AppendUpdate(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    return AppendDocument(static_cast<uint8_t>(RecordType::UPDATE), document_id, document, status, ratings);
+}
+
+uint64_t WriteAheadLog::AppendUpdateAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings) {
+    return AppendDocument(static_cast<uint8_t>(RecordType::UPDATE_ATTRIBUTES), document_id, {}, status, ratings);
+}
+
+uint64_t WriteAheadLog::AppendRemove(int document_id) {
+    std::string payload;
+    Put(payload, static_cast<uint8_t>(RecordType::REMOVE));
+    Put(payload, static_cast<int32_t>(document_id));
+    return Append(payload);
+}
+
+uint64_t WriteAheadLog::AppendDocument(uint8_t type, int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    std::string payload;
+    payload.reserve(sizeof(uint8_t) * 2 + sizeof(int32_t) + sizeof(uint32_t) + ratings.size() * sizeof(int32_t) + document.size());
+    Put(payload, type);
+    Put(payload, static_cast<int32_t>(document_id));
+    Put(payload, static_cast<uint8_t>(status));
+    Put(payload, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        Put(payload, static_cast<int32_t>(rating));
+    }
+    payload.append(document);
+    return Append(payload);
+}
+
+uint64_t WriteAheadLog::Append(std::string_view payload) {
+    std::unique_lock lock(mutex_);
+    if (commit_error_) {
+        std::rethrow_exception(commit_error_);
+    }
+    // первая запись пакета будит фоновый поток, с нее начинается ожидание commit_interval
+    const bool first_in_batch = pending_.empty();
+    Put(pending_, static_cast<uint32_t>(payload.size()));
+    Put(pending_, ComputeCrc32(payload));
+    pending_.append(payload);
+    const uint64_t sequence = ++last_sequence_;
+    if (first_in_batch || pending_.size() >= config_.max_batch_bytes) {
+        lock.unlock();
+        commit_requested_.notify_one();
+    }
+    return sequence;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence) {
+    std::unique_lock lock(mutex_);
+    WaitCommitted(lock, sequence);
+}
+
+void WriteAheadLog::Sync() {
+    std::unique_lock lock(mutex_);
+    const uint64_t sequence = last_sequence_;
+    sync_requested_ = true;
+    commit_requested_.notify_one();
+    WaitCommitted(lock, sequence);
+}
+
+void WriteAheadLog::WaitCommitted(std::unique_lock<std::mutex>& lock, uint64_t sequence) {
+    commit_done_.wait(lock, [&] { return durable_sequence_ >= sequence || commit_error_; });
+    if (durable_sequence_ < sequence) {
+        std::rethrow_exception(commit_error_);
+    }
+}
+
+void WriteAheadLog::Truncate() {
+    std::lock_guard file_lock(file_mutex_);
+    std::lock_guard lock(mutex_);
+    if (commit_error_) {
+        std::rethrow_exception(commit_error_);
+    }
+    pending_.clear();
+    if (ftruncate(fd_, 0) < 0 || fdatasync(fd_) < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot truncate " + path_);
+    }
+    durable_sequence_ = last_sequence_;
+    commit_done_.notify_all();
+}
+
+uint64_t WriteAheadLog::GetDurableSequence() const {
+    std::lock_guard lock(mutex_);
+    return durable_sequence_;
+}
+
+uint64_t WriteAheadLog::GetCommitCount() const {
+    std::lock_guard lock(mutex_);
+    return commit_count_;
+}
+
+void WriteAheadLog::RunCommitter() {
+    std::string batch;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            // первая запись пакета ждет commit_interval, чтобы к ней присоединились следующие
+            commit_requested_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+            commit_requested_.wait_for(lock, config_.commit_interval, [&] {
+                return stopping_ || sync_requested_ || pending_.size() >= config_.max_batch_bytes;
+                });
+            if (stopping_ && pending_.empty()) {
+                return;
+            }
+        }
+        std::lock_guard file_lock(file_mutex_);
+        uint64_t sequence = 0;
+        {
+            std::lock_guard lock(mutex_);
+            batch.swap(pending_);
+            sequence = last_sequence_;
+            sync_requested_ = false;
+        }
+        if (!batch.empty()) {
+            // после ошибки диска записи пакета ненадежны, а файл может содержать его часть:
+            // ожидающие получают ошибку вместо подтверждения, фоновый поток завершается
+            try {
+                WriteAll(fd_, batch, path_);
+                if (fdatasync(fd_) < 0) {
+                    throw std::system_error(errno, std::generic_category(), "cannot sync " + path_);
+                }
+            }
+            catch (const std::system_error&) {
+                std::lock_guard lock(mutex_);
+                commit_error_ = std::current_exception();
+                commit_done_.notify_all();
+                return;
+            }
+            batch.clear();
+        }
+        std::lock_guard lock(mutex_);
+        durable_sequence_ = std::max(durable_sequence_, sequence);
+        ++commit_count_;
+        commit_done_.notify_all();
+    }
+}
+
+size_t ReplayWriteAheadLog(SearchServer& search_server, const std::string& path) {
+    struct stat info {};
+    if (stat(path.c_str(), &info) < 0) {
+        return 0;
+    }
+    size_t record_count = 0;
+    size_t valid_size = 0;
+    {
+        const MappedFile log(path);
+        std::string_view data = log.GetData();
+        std::vector<int> ratings;
+        while (data.size() >= RECORD_HEADER_SIZE) {
+            uint32_t size = 0;
+            uint32_t crc = 0;
+            std::string_view header = data;
+            Get(header, size);
+            Get(header, crc);
+            if (header.size() < size) {
+                break;
+            }
+            const std::string_view payload = header.substr(0, size);
+            if (ComputeCrc32(payload) != crc || !ApplyRecord(search_server, payload, ratings)) {
+                break;
+            }
+            ++record_count;
+            data.remove_prefix(RECORD_HEADER_SIZE + size);
+            valid_size += RECORD_HEADER_SIZE + size;
+        }
+    }
+    // хвост, не прошедший проверку, отрезается, чтобы новые записи шли сразу за целыми
+    if (valid_size < static_cast<size_t>(info.st_size) && truncate(path.c_str(), valid_size) < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot truncate " + path);
+    }
+    return record_count;
+}
+
+size_t RecoverIndex(SearchServer& search_server, const std::string& snapshot_path, const std::string& log_path) {
+    struct stat info {};
+    if (stat(snapshot_path.c_str(), &info) == 0) {
+        LoadCorpus(search_server, snapshot_path);
+    }
+    return ReplayWriteAheadLog(search_server, log_path);
+}
+
+void Checkpoint(const SearchServer& search_server, WriteAheadLog& log, const std::string& snapshot_path) {
+    SaveCorpus(search_server, snapshot_path);
+    log.Truncate();
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+class SearchServer;
+
+struct WriteAheadLogConfig {
+    // сколько запись ждет, пока к ней присоединятся другие, перед общим fsync
+    std::chrono::microseconds commit_interval{ 2000 };
+    // пакет записывается раньше, если накопилось столько байт
+    size_t max_batch_bytes = 1 << 20;
+};
+
+// журнал изменений индекса (только дописывание). Записи копятся в памяти и сбрасываются
+// на диск пакетами одним write и одним fdatasync (групповая фиксация) в фоновом потоке.
+// Append* не ждут диска: запись становится надежной не позже чем через commit_interval,
+// а кому нужно подтверждение, вызывает WaitDurable(номер записи) или Sync().
+// Ошибка write или fdatasync фонового потока сохраняется: ожидание ненадежных записей и
+// все последующие Append* бросают std::system_error, новые пакеты не записываются.
+// Формат записи: длина, CRC32 и данные; оборванная при сбое запись в конце отбрасывается
+class WriteAheadLog {
+public:
+    explicit WriteAheadLog(const std::string& path, WriteAheadLogConfig config = {});
+
+    // сбрасывает оставшиеся записи на диск
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // возвращают номер записи
+    uint64_t AppendAdd(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendUpdate(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendUpdateAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendRemove(int document_id);
+
+    // ожидание, пока запись с номером sequence и все предыдущие окажутся на диске. Пакет
+    // не сбрасывается досрочно: ожидание длится до конца commit_interval, чтобы к пакету
+    // успели присоединиться записи других потоков. Для немедленного сброса - Sync()
+    void WaitDurable(uint64_t sequence);
+    // немедленный сброс всех записей
+    void Sync();
+
+    // очистка журнала после снимка индекса: все записанные изменения уже есть в снимке
+    void Truncate();
+
+    uint64_t GetDurableSequence() const;
+    // количество выполненных fdatasync
+    uint64_t GetCommitCount() const;
+
+private:
+    std::string path_;
+    WriteAheadLogConfig config_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable commit_requested_;
+    std::condition_variable commit_done_;
+    std::string pending_;
+    uint64_t last_sequence_ = 0;
+    uint64_t durable_sequence_ = 0;
+    uint64_t commit_count_ = 0;
+    bool sync_requested_ = false;
+    bool stopping_ = false;
+    // ошибка записи пакета (std::system_error)
+    std::exception_ptr commit_error_;
+
+    // захватывается на время записи пакета, чтобы Truncate не пересекся с ней
+    std::mutex file_mutex_;
+    std::thread committer_;
+
+    uint64_t Append(std::string_view payload);
+    // ожидание надежности записи sequence под захваченным mutex_
+    void WaitCommitted(std::unique_lock<std::mutex>& lock, uint64_t sequence);
+    uint64_t AppendDocument(uint8_t type, int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RunCommitter();
+};
+
+// применение журнала к индексу (обычно загруженному из снимка). Повтор изменений, уже
+// вошедших в снимок, безопасен: добавление существующего id пропускается, изменение текста
+// отсутствующего документа добавляет его, изменение статуса и рейтинга отсутствующего
+// документа пропускается, а остальные изменения приводят к тому же состоянию. Оборванная запись
+// в конце журнала отрезается. Журнал не должен быть подключен к серверу во время применения.
+// Возвращает количество примененных записей
+size_t ReplayWriteAheadLog(SearchServer& search_server, const std::string& path);
+
+// восстановление после сбоя: загрузка снимка (если он есть) и применение журнала
+size_t RecoverIndex(SearchServer& search_server, const std::string& snapshot_path, const std::string& log_path);
+
+// контрольная точка: снимок индекса записывается атомарно, после чего журнал очищается
+void Checkpoint(const SearchServer& search_server, WriteAheadLog& log, const std::string& snapshot_path);